@@ -0,0 +1,66 @@
+/**
+ * C++ BBUnit: Assertion micro-benchmark
+ *
+ * Measures the cost of a single (passing) assertion, in nanoseconds,
+ * which is the overhead BBUnit adds to every check in a test suite.
+ */
+
+#include <bbunit/bbunit.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+using namespace BBUnit;
+
+namespace BBUnit::Benchmarks {
+    class AssertionBenchmark : public TestCase {
+    public:
+        void test() override {
+            measure("assertEquals<int>", [&](size_t i) {
+                assertEquals<int>(static_cast<int>(i), static_cast<int>(i));
+            });
+
+            measure("assertTrue", [&](size_t i) {
+                assertTrue(i != static_cast<size_t>(-1));
+            });
+
+            const std::string subject = "A string which is too long for SSO";
+            measure("assertEquals<std::string>", [&](size_t) {
+                assertEquals<std::string>(subject, subject);
+            });
+        }
+
+    private:
+        static constexpr size_t iterations = 1'000'000;
+
+        template<typename F>
+        void measure(const char *name, F &&func) {
+            // Each round runs in a fresh ``it`` scope, so the cost of storing
+            // results is included, as it would be in a real suite. The scopes
+            // are silenced, so the rounds don't pile up in memory.
+            double best = 0;
+            for (int round = 0; round < 5; ++round) {
+                auto begin = std::chrono::steady_clock::now();
+                whileSilent([&]() -> TestResults {
+                    return it(name, [&]() {
+                        for (size_t i = 0; i < iterations; ++i) {
+                            func(i);
+                        }
+                    });
+                });
+                auto elapsed = std::chrono::steady_clock::now() - begin;
+
+                double ns = std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+                best = round == 0 ? ns : std::min(best, ns);
+            }
+
+            std::printf("%-28s %8.2f ns/assertion\n", name, best);
+        }
+    };
+}
+
+int main() {
+    Benchmarks::AssertionBenchmark benchmark;
+    benchmark.run();
+}
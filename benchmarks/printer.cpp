@@ -0,0 +1,49 @@
+/**
+ * C++ BBUnit: Printer benchmark
+ *
+ * Measures how many result lines per second the console printer writes,
+ * with ``printPassed`` enabled. Redirect the output, so the terminal isn't
+ * what's being measured:
+ *
+ * ````bash
+ * ./benchmark-printer > /dev/null
+ * ````
+ */
+
+#include <bbunit/bbunit.hpp>
+#include <bbunit/utilities/printer.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+using namespace BBUnit;
+
+int main() {
+    constexpr size_t count = 1'000'000;
+
+    // Mostly passed assertions, with a failure (with expected/actual values) every 100th
+    TestResults results;
+    results.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        if (i % 1000 == 0) {
+            results.beginScope("Scope number " + std::to_string(i / 1000), "PrinterBenchmark");
+        }
+        auto caseNo = static_cast<CaseNumber>(i % 1000 + 1);
+        if (i % 100 == 0) {
+            results.addResult(caseNo, false, std::to_string(i), std::to_string(i + 1));
+        } else {
+            results.addPassed(caseNo);
+        }
+    }
+
+    double best = 0;
+    for (int round = 0; round < 3; ++round) {
+        auto begin = std::chrono::steady_clock::now();
+        Utilities::Printer::print(results, {.printPassed = true});
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        best = round == 0 ? seconds : std::min(best, seconds);
+    }
+
+    std::fprintf(stderr, "%-28s %8.2f M lines/second\n", "Printer (printPassed)", count / best / 1e6);
+}
@@ -7,6 +7,10 @@ add_library(cpp_bbunit
         ${PACKAGE_PREFIX_DIR}/include/bbunit/bbunit.hpp
 )
 
+# The parallel runner uses std::thread
+find_package(Threads REQUIRED)
+target_link_libraries(cpp_bbunit INTERFACE Threads::Threads)
+
 target_include_directories(cpp_bbunit
         INTERFACE
         $<BUILD_INTERFACE:${PACKAGE_PREFIX_DIR}/include>
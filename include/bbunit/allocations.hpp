@@ -0,0 +1,411 @@
+/**
+ * C++ BBUnit - Allocation tracking
+ *
+ * Counts the allocations made through ``operator new`` by each thread, for
+ * ``assertNoAllocations``, ``assertAllocationsAtMost`` and the allocation
+ * statistics of every ``it`` scope.
+ *
+ * Tracking is opt-in: define ``BBUNIT_TRACK_ALLOCATIONS`` before including
+ * BBUnit in exactly one source file (typically the one with ``main``), which
+ * then replaces the global ``operator new`` and ``operator delete``.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+#ifdef BBUNIT_TRACK_ALLOCATIONS
+#include <cstdlib>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+#endif
+
+namespace BBUnit {
+    /**
+     * Allocations made by a thread, during an ``it`` scope or a measurement.
+     *
+     * Releases are counted by the thread which releases the memory. So memory
+     * which another thread releases still counts as leaked, and as in use for
+     * ``peakBytes``, in the thread which allocated it.
+     */
+    struct AllocationCounts {
+        /**
+         * Number of calls to ``operator new``.
+         */
+        uint64_t allocations = 0;
+
+        /**
+         * Number of calls to ``operator delete`` by the thread, for memory which was counted
+         * when it was allocated (by any thread).
+         */
+        uint64_t deallocations = 0;
+
+        /**
+         * Bytes requested in total.
+         */
+        uint64_t bytes = 0;
+
+        /**
+         * Largest number of bytes allocated and not yet released at any one time,
+         * counting from the start.
+         */
+        uint64_t peakBytes = 0;
+
+        /**
+         * Allocations made, but not released by the end.
+         */
+        uint64_t leaked = 0;
+        uint64_t leakedBytes = 0;
+    };
+
+    namespace Internal {
+        /**
+         * Allocation counters of a thread. Only plain integers, so the thread-local
+         * storage needs neither construction nor destruction, and is safe to use
+         * from ``operator new`` at any time.
+         */
+        struct AllocationState {
+            uint64_t allocations = 0;
+            uint64_t deallocations = 0;
+            uint64_t bytes = 0;
+            int64_t live = 0;
+            int64_t peak = 0;
+
+            /**
+             * The scope being tracked (``0`` when none), and the allocations made
+             * in it which haven't been released yet.
+             */
+            uint64_t scope = 0;
+            uint64_t outstanding = 0;
+            uint64_t outstandingBytes = 0;
+
+            /**
+             * While above zero, allocations aren't counted, which is used for
+             * BBUnit's own bookkeeping.
+             */
+            uint32_t paused = 0;
+        };
+
+        inline thread_local constinit AllocationState allocationState{};
+
+        /**
+         * Set when the hooks are installed, see ``BBUNIT_TRACK_ALLOCATIONS``.
+         */
+        inline std::atomic<bool> allocationHooks{false};
+
+        inline std::atomic<uint64_t> allocationScopes{0};
+
+        /**
+         * Bookkeeping in front of every allocation, made by the hooks. The
+         * ``scope`` is ``0`` for allocations which aren't counted.
+         */
+        struct alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) AllocationHeader {
+            size_t size;
+            uint64_t scope;
+        };
+
+        /**
+         * Count an allocation.
+         *
+         * @return The scope to tag the allocation with.
+         */
+        inline uint64_t countAllocation(size_t size) noexcept {
+            AllocationState &state = allocationState;
+            if (state.paused > 0) {
+                return 0;
+            }
+            ++state.allocations;
+            state.bytes += size;
+            state.live += static_cast<int64_t>(size);
+            state.peak = std::max(state.peak, state.live);
+            ++state.outstanding;
+            state.outstandingBytes += size;
+            // Allocations outside a scope are tagged too, so their release is counted
+            return state.scope == 0 ? UINT64_MAX : state.scope;
+        }
+
+        /**
+         * Count the release of an allocation. Releases are counted while paused
+         * too, since only the allocation decides whether the memory is counted.
+         */
+        inline void countDeallocation(const AllocationHeader &header) noexcept {
+            AllocationState &state = allocationState;
+            if (header.scope == 0) {
+                return;
+            }
+            ++state.deallocations;
+            state.live -= static_cast<int64_t>(header.size);
+            if (header.scope == state.scope) {
+                --state.outstanding;
+                state.outstandingBytes -= header.size;
+            }
+        }
+    }
+
+    /**
+     * Allocation tracking, see ``BBUNIT_TRACK_ALLOCATIONS``.
+     */
+    class Allocations {
+    public:
+        /**
+         * Whether allocations are tracked, which is when a source file of the
+         * program defines ``BBUNIT_TRACK_ALLOCATIONS``.
+         *
+         * @return
+         */
+        [[nodiscard]] static bool enabled() noexcept {
+            return Internal::allocationHooks.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Tracks the allocations of the calling thread from construction until
+         * ``finish``. Trackers can be nested; the allocations of an inner tracker
+         * count toward the outer one too, except as leaks.
+         */
+        class Tracker {
+        public:
+            Tracker() noexcept : m_outer(Internal::allocationState) {
+                Internal::AllocationState &state = Internal::allocationState;
+                state.scope = Internal::allocationScopes.fetch_add(1, std::memory_order_relaxed) + 1;
+                state.peak = state.live;
+                state.outstanding = 0;
+                state.outstandingBytes = 0;
+            }
+
+            Tracker(const Tracker &) = delete;
+            Tracker &operator=(const Tracker &) = delete;
+
+            ~Tracker() {
+                if (!m_finished) {
+                    finish();
+                }
+            }
+
+            /**
+             * Stop tracking. Calling it again returns the same counts.
+             *
+             * @return The allocations made since the tracker was constructed.
+             */
+            AllocationCounts finish() noexcept {
+                if (m_finished) {
+                    return m_counts;
+                }
+                Internal::AllocationState &state = Internal::allocationState;
+                m_counts = {
+                        .allocations = state.allocations - m_outer.allocations,
+                        .deallocations = state.deallocations - m_outer.deallocations,
+                        .bytes = state.bytes - m_outer.bytes,
+                        .peakBytes = static_cast<uint64_t>(std::max<int64_t>(0, state.peak - m_outer.live)),
+                        .leaked = state.outstanding,
+                        .leakedBytes = state.outstandingBytes,
+                };
+                state.scope = m_outer.scope;
+                state.peak = std::max(state.peak, m_outer.peak);
+                state.outstanding = m_outer.outstanding;
+                state.outstandingBytes = m_outer.outstandingBytes;
+                m_finished = true;
+                return m_counts;
+            }
+
+        private:
+            /**
+             * The state when the tracker was constructed.
+             */
+            Internal::AllocationState m_outer;
+
+            AllocationCounts m_counts;
+
+            bool m_finished = false;
+        };
+
+        /**
+         * Stops counting the allocations of the calling thread while in scope.
+         * Releasing memory which was counted is still counted.
+         */
+        class Pause {
+        public:
+            Pause() noexcept {
+                ++Internal::allocationState.paused;
+            }
+
+            Pause(const Pause &) = delete;
+            Pause &operator=(const Pause &) = delete;
+
+            ~Pause() {
+                --Internal::allocationState.paused;
+            }
+        };
+
+        /**
+         * Count the allocations made by the calling thread while calling ``func``.
+         *
+         * @tparam F
+         * @param func
+         * @return
+         */
+        template<typename F>
+        static AllocationCounts measure(F &&func) noexcept(false) {
+            Tracker tracker;
+            func();
+            return tracker.finish();
+        }
+    };
+}
+
+#ifdef BBUNIT_TRACK_ALLOCATIONS
+namespace BBUnit::Internal {
+    static const bool allocationHooksInstalled = (allocationHooks.store(true), true);
+
+    /**
+     * Allocate ``size`` bytes behind an ``AllocationHeader``, aligned to ``alignment``.
+     */
+    inline void *trackedAllocate(size_t size, size_t alignment) noexcept {
+        size_t offset = std::max(alignment, sizeof(AllocationHeader));
+        void *base;
+        if (alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            base = std::malloc(size + offset);
+        } else {
+#ifdef _WIN32
+            base = _aligned_malloc(size + offset, alignment);
+#else
+            // The size must be a multiple of the alignment
+            base = std::aligned_alloc(alignment, (size + offset + alignment - 1) / alignment * alignment);
+#endif
+        }
+        if (!base) {
+            return nullptr;
+        }
+        auto *memory = static_cast<char *>(base) + offset;
+        auto *header = reinterpret_cast<AllocationHeader *>(memory) - 1;
+        header->size = size;
+        header->scope = countAllocation(size);
+        return memory;
+    }
+
+    inline void trackedRelease(void *memory, size_t alignment) noexcept {
+        if (!memory) {
+            return;
+        }
+        countDeallocation(*(static_cast<AllocationHeader *>(memory) - 1));
+        void *base = static_cast<char *>(memory) - std::max(alignment, sizeof(AllocationHeader));
+#ifdef _WIN32
+        if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            _aligned_free(base);
+            return;
+        }
+#endif
+        std::free(base);
+    }
+
+    /**
+     * Allocate as ``operator new`` does: retry through the new-handler, and
+     * throw ``std::bad_alloc`` when there's none.
+     */
+    inline void *trackedNew(size_t size, size_t alignment) {
+        size = std::max<size_t>(size, 1);
+        while (true) {
+            if (void *memory = trackedAllocate(size, alignment)) {
+                return memory;
+            }
+            std::new_handler handler = std::get_new_handler();
+            if (!handler) {
+                throw std::bad_alloc();
+            }
+            handler();
+        }
+    }
+
+    inline void *trackedNew(size_t size, size_t alignment, const std::nothrow_t &) noexcept {
+        try {
+            return trackedNew(size, alignment);
+        } catch (...) {
+            return nullptr;
+        }
+    }
+}
+
+void *operator new(size_t size) {
+    return BBUnit::Internal::trackedNew(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void *operator new[](size_t size) {
+    return BBUnit::Internal::trackedNew(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void *operator new(size_t size, std::align_val_t alignment) {
+    return BBUnit::Internal::trackedNew(size, static_cast<size_t>(alignment));
+}
+
+void *operator new[](size_t size, std::align_val_t alignment) {
+    return BBUnit::Internal::trackedNew(size, static_cast<size_t>(alignment));
+}
+
+void *operator new(size_t size, const std::nothrow_t &nothrow) noexcept {
+    return BBUnit::Internal::trackedNew(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__, nothrow);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &nothrow) noexcept {
+    return BBUnit::Internal::trackedNew(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__, nothrow);
+}
+
+void *operator new(size_t size, std::align_val_t alignment, const std::nothrow_t &nothrow) noexcept {
+    return BBUnit::Internal::trackedNew(size, static_cast<size_t>(alignment), nothrow);
+}
+
+void *operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t &nothrow) noexcept {
+    return BBUnit::Internal::trackedNew(size, static_cast<size_t>(alignment), nothrow);
+}
+
+void operator delete(void *memory) noexcept {
+    BBUnit::Internal::trackedRelease(memory, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void operator delete[](void *memory) noexcept {
+    BBUnit::Internal::trackedRelease(memory, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void operator delete(void *memory, size_t) noexcept {
+    BBUnit::Internal::trackedRelease(memory, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void operator delete[](void *memory, size_t) noexcept {
+    BBUnit::Internal::trackedRelease(memory, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void operator delete(void *memory, std::align_val_t alignment) noexcept {
+    BBUnit::Internal::trackedRelease(memory, static_cast<size_t>(alignment));
+}
+
+void operator delete[](void *memory, std::align_val_t alignment) noexcept {
+    BBUnit::Internal::trackedRelease(memory, static_cast<size_t>(alignment));
+}
+
+void operator delete(void *memory, size_t, std::align_val_t alignment) noexcept {
+    BBUnit::Internal::trackedRelease(memory, static_cast<size_t>(alignment));
+}
+
+void operator delete[](void *memory, size_t, std::align_val_t alignment) noexcept {
+    BBUnit::Internal::trackedRelease(memory, static_cast<size_t>(alignment));
+}
+
+void operator delete(void *memory, const std::nothrow_t &) noexcept {
+    BBUnit::Internal::trackedRelease(memory, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void operator delete[](void *memory, const std::nothrow_t &) noexcept {
+    BBUnit::Internal::trackedRelease(memory, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void operator delete(void *memory, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+    BBUnit::Internal::trackedRelease(memory, static_cast<size_t>(alignment));
+}
+
+void operator delete[](void *memory, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+    BBUnit::Internal::trackedRelease(memory, static_cast<size_t>(alignment));
+}
+#endif
@@ -11,16 +11,46 @@
 #pragma once
 
 #include <algorithm>
+#include <concepts>
+#include <cstdlib>
+#include <cstring>
 #include <functional>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <regex>
+#include <stdexcept>
+#include <string_view>
 #include <variant>
 #include <vector>
 
+#if defined(__GNUG__)
+#include <cxxabi.h>
+#endif
+
+#include "allocations.hpp"
+#include "benchmark.hpp"
+#include "diff.hpp"
+#include "formatter.hpp"
+#include "numeric.hpp"
+#include "property.hpp"
+#include "utilities/failure-budget.hpp"
+#include "utilities/name-filter.hpp"
+#include "utilities/perf-counters.hpp"
+#include "utilities/process-pool.hpp"
+#include "utilities/regex-cache.hpp"
+#include "utilities/results-database.hpp"
+#include "utilities/sharding.hpp"
+#include "utilities/stopwatch.hpp"
+#include "utilities/thread-pool.hpp"
+
 namespace BBUnit {
-    typedef uint16_t CaseNumber;
+    /**
+     * Number of an assertion within its ``it`` scope. 64-bit, since results
+     * streamed to a sink don't limit how many assertions a scope can make.
+     */
+    typedef uint64_t CaseNumber;
 
     /**
      * Concept used to ensure a type can be compared to itself.
@@ -74,8 +104,42 @@ namespace BBUnit {
          * you try to access a ``std::optional``'s value, and it doesn't have one.
          */
         ExceptionCaught,
+
+        /**
+         * The test case crashed (for example with a segmentation fault) while
+         * running in an isolated process. See ``Settings::isolated``.
+         */
+        Crashed,
+
+        /**
+         * The test case exceeded ``Settings::timeout`` while running in an
+         * isolated process, and was stopped.
+         */
+        TimedOut,
     };
 
+    /**
+     * The name of an error code, such as ``"ExceptionCaught"``, for machine-readable reports.
+     *
+     * @param errorCode
+     * @return
+     */
+    [[nodiscard]] inline const char *errorCodeName(ErrorCode errorCode) noexcept {
+        switch (errorCode) {
+            case ErrorCode::PrevAssertionFailed:
+                return "PrevAssertionFailed";
+            case ErrorCode::ExceptionCaught:
+                return "ExceptionCaught";
+            case ErrorCode::Crashed:
+                return "Crashed";
+            case ErrorCode::TimedOut:
+                return "TimedOut";
+        }
+        return "Unknown";
+    }
+
+    class ResultSink;
+
     /**
      * Settings passed into the ``TestRunner`` and read by ``TestCase``.
      */
@@ -86,6 +150,192 @@ namespace BBUnit {
          * cluttering the result output.
          */
         bool stopAssertingAfterFail = true;
+
+        /**
+         * When one assertion fails, skip the rest of the ``it`` scope right away.
+         * Unlike ``stopAssertingAfterFail``, the following assertions aren't
+         * evaluated at all, and leave nothing in the results.
+         */
+        bool skipScopeAfterFail = false;
+
+        /**
+         * Stop the run once this many assertions have failed (or caused errors)
+         * across all test cases. Scopes in progress are cut short at their next
+         * assertion, and the remaining scopes and test cases are skipped.
+         * When ``0``, there's no limit.
+         */
+        size_t maxFailures = 0;
+
+        /**
+         * When true, the ``TestRunner`` runs the test cases in parallel
+         * on a work-stealing thread pool. Results are still returned in the
+         * order the test cases were provided.
+         *
+         * Each ``TestCase`` instance must only appear once in the list.
+         */
+        bool parallel = false;
+
+        /**
+         * Number of threads used when running in parallel.
+         * When ``0``, the hardware concurrency is used.
+         */
+        unsigned int threads = 0;
+
+        /**
+         * When true, the ``TestRunner`` runs the test cases in a pool of worker
+         * processes (``threads`` of them), so a test case which crashes or hangs
+         * is reported as an error, rather than taking down the whole run.
+         *
+         * Only available on POSIX platforms. Elsewhere, the setting is ignored.
+         */
+        bool isolated = false;
+
+        /**
+         * Max. duration of a test case running in isolation. Test cases which
+         * exceed it are stopped, and reported as ``ErrorCode::TimedOut``.
+         * When ``0``, there's no limit.
+         */
+        std::chrono::milliseconds timeout{0};
+
+        /**
+         * Split the test cases into ``shardCount`` disjoint shards, and only
+         * run shard number ``shardIndex`` (counting from ``0``). The shards are
+         * balanced by the durations in ``caseDurations``, when provided.
+         *
+         * The ``TestRunner`` throws ``std::invalid_argument`` when ``shardIndex``
+         * isn't below ``shardCount``.
+         */
+        unsigned int shardIndex = 0, shardCount = 1;
+
+        /**
+         * Only run the test cases whose name (see ``TestCase::name``) matches.
+         */
+        Utilities::NameFilter caseFilter;
+
+        /**
+         * Only evaluate the ``it`` scopes whose description matches. Other
+         * scopes are skipped before their function is called. Scopes silenced
+         * with ``whileSilent`` are inspected by the test itself, and always evaluated.
+         */
+        Utilities::NameFilter itFilter;
+
+        /**
+         * Enumerate the ``it`` scopes, without evaluating them. The results
+         * contain the scopes (see ``TestResults::scopes``), but no assertions.
+         * Scopes silenced with ``whileSilent`` are evaluated, and not listed.
+         */
+        bool listOnly = false;
+
+        /**
+         * By default, expected and actual values are only rendered (as strings)
+         * for assertions which fail. Enable this to record them for passed
+         * assertions as well, for example for a reporter which shows them.
+         */
+        bool recordPassedValues = false;
+
+        /**
+         * Measure the time spent on each assertion (see ``TestInfo::timing``).
+         * The time spent on ``it`` scopes and test cases is always measured.
+         */
+        bool timeAssertions = false;
+
+        /**
+         * Count the cycles, instructions, cache misses and branch misses of each
+         * ``it`` scope with the hardware performance counters (see ``Scope::counters``).
+         *
+         * Where the counters aren't available, for example in containers without
+         * access to them, the scopes are only timed.
+         */
+        bool countHardwareEvents = false;
+
+        /**
+         * Cache of compiled patterns used by ``assertRegex``.
+         *
+         * By default, the whole process shares one cache (see ``RegexCache::shared``).
+         * Provide your own to inspect its hit/miss counters, or ``nullptr`` to
+         * compile the patterns on every assertion.
+         */
+        std::shared_ptr<Utilities::RegexCache> regexCache = Utilities::RegexCache::shared();
+
+        /**
+         * When provided, results are streamed to this sink while the tests
+         * are running, instead of being collected and returned at the end.
+         * The ``TestRunner`` calls ``finish`` on the sink when the run completes.
+         */
+        std::shared_ptr<ResultSink> sink;
+
+        /**
+         * Results are buffered, and handed to the ``sink`` in batches of at least
+         * this many results. This also applies within ``it`` scopes, so a scope
+         * with many assertions is never fully buffered.
+         *
+         * When ``0``, results are handed over whenever an ``it`` scope completes.
+         */
+        size_t sinkBatchSize = 0;
+
+        /**
+         * How benchmarks are measured, unless specified for the individual benchmark.
+         */
+        BenchmarkOptions benchmarkOptions;
+
+        /**
+         * Baseline used by ``assertNoSlowerThanBaseline``.
+         */
+        std::shared_ptr<BenchmarkBaseline> benchmarkBaseline;
+
+        /**
+         * How properties are checked by ``forAll``, unless specified for the individual property.
+         */
+        PropertyOptions propertyOptions;
+
+        /**
+         * Durations of test cases, used to balance the shards. The ``TestRunner``
+         * records the durations of the test cases it runs, and saves the file
+         * when the run completes. Instances of the same class share a duration,
+         * unless they override ``TestCase::name``.
+         */
+        std::shared_ptr<Utilities::CaseDurations> caseDurations;
+
+        /**
+         * Counts the failures against ``maxFailures``. It's created by the ``TestRunner``,
+         * and shared by all the test cases of the run. Provide your own to share it
+         * across runs, or to cancel a run from the outside.
+         */
+        std::shared_ptr<Utilities::FailureBudget> failureBudget;
+
+        /**
+         * Outcome of each test case in previous runs. The ``TestRunner`` records
+         * the test cases it runs, and saves the file when the run completes.
+         */
+        std::shared_ptr<Utilities::ResultsDatabase> resultsDatabase;
+
+        /**
+         * Only run the test cases which failed the last time they ran
+         * (according to ``resultsDatabase``).
+         */
+        bool rerunFailed = false;
+
+        /**
+         * Only run the test cases which are new, or whose ``TestCase::version``
+         * differs from the last time they ran (according to ``resultsDatabase``).
+         * Combined with ``rerunFailed``, test cases matching either are run.
+         */
+        bool changedOnly = false;
+    };
+
+    /**
+     * Time spent on a test, an ``it`` scope, or an assertion.
+     */
+    struct Timing {
+        /**
+         * Wall-clock time.
+         */
+        std::chrono::nanoseconds wall{0};
+
+        /**
+         * CPU time spent by the thread running the test.
+         */
+        std::chrono::nanoseconds cpu{0};
     };
 
     /**
@@ -109,6 +359,12 @@ namespace BBUnit {
          * Additional information provided to a single assertion, using ``because``.
          */
         std::string additional;
+
+        /**
+         * Time spent on the assertion. Only measured when ``Settings::timeAssertions``
+         * is enabled.
+         */
+        Timing timing;
     };
 
     /**
@@ -201,162 +457,1183 @@ namespace BBUnit {
         }
     };
 
+    class TestResults;
+
     /**
-     * A container of multiple test results.
+     * Light-weight view of a single result stored in ``TestResults``.
+     *
+     * The values are read directly from the compact storage. Use ``get``
+     * and ``error`` (or convert it to a ``Result``) to obtain a copy in
+     * the form of a ``TestResult`` or ``Error``.
      */
-    class TestResults : public std::vector<Result> {
+    class ResultRef {
     public:
-        using std::vector<Result>::vector;
+        ResultRef(const TestResults &results, size_t index) noexcept : m_results(&results), m_index(index) {}
 
         /**
-         * Easily append more results, on the form:
-         *
-         * ````cpp
-         * currentResults += newResults;
-         * ````
+         * Returns true, if the result is an ``Error``.
          *
-         * @param other
+         * @return
          */
-        void operator+=(const TestResults &other) {
-            *this->insert(this->end(), other.begin(), other.end());
-        }
-    };
+        [[nodiscard]] bool isErr() const noexcept;
 
-    /**
-     * Trait to be used under ``TestCase``, whose primary purpose
-     * is to define the available assertion methods, as well as
-     * managing the assertion handling.
-     */
-    class ProvidesAssertions {
-    public:
         /**
-         * Used in the library's self-testing.
+         * If the assertion passed. Always false for errors.
+         *
+         * @return
          */
-        enum class Must {
-            /**
-             * The assertion must have passed.
-             */
-            HavePassed,
+        [[nodiscard]] bool passed() const noexcept;
 
-            /**
-             * The assertion is expected to have failed.
-             */
-            HaveFailed,
+        [[nodiscard]] CaseNumber caseNo() const noexcept;
 
-            /**
-             * The assertion is expected to have caused an error,
-             * for example with trying to make assertions after a failed
-             * assert, or by throwing errors (such as ``std::bad_optional_access``).
-             */
-            HaveCausedError,
-        };
+        [[nodiscard]] const std::string &description() const noexcept;
 
         /**
-         * Provide additional descriptive information to a specific assertion.
+         * Name of the test case the result belongs to.
          *
-         * @param msg
          * @return
          */
-        ProvidesAssertions &because(const std::string &msg) noexcept(false) {
-            if (m_testResults.empty()) {
-                return *this;
-            }
-            Result res = m_testResults[m_testResults.size() - 1];
-            if (res.isErr()) {
-                Error tmp = res.error();
-                tmp.info.additional = msg;
-                m_testResults[m_testResults.size() - 1] = tmp;
-            } else {
-                TestResult tmp = res.get();
-                tmp.info.additional = msg;
-                m_testResults[m_testResults.size() - 1] = tmp;
-            }
-            return *this;
-        }
+        [[nodiscard]] const std::string &testCase() const noexcept;
 
         /**
-         * Used for the library's self-testing mechanism.
+         * Position of the result's scope in ``TestResults::scopes``.
          *
-         * It's appended to a specific assertion, and this method will then
-         * verify the result the assertion has produced. Furthermore, this
-         * method will adjust the results.
+         * @return
+         */
+        [[nodiscard]] size_t scopeIndex() const noexcept;
+
+        /**
+         * Time spent on the assertion (see ``Settings::timeAssertions``).
          *
-         * For example, if an assertion is expected to have have a failed result.
-         * Let's say, if it needs to check that two integers are equals, and
-         * ``2`` and ``5`` were passed. In that case, the test fails.
-         * However, if that is the expected outcome as part of the self-test,
-         * this method will modify the ``TestResult`` to ensure correct reporting
-         * in the test results. Because, from the point-of-view of BBUnit,
-         * the test has actually passed.
+         * @return
+         */
+        [[nodiscard]] Timing timing() const noexcept;
+
+        [[nodiscard]] const std::string &additional() const noexcept;
+
+        [[nodiscard]] const std::string &expected() const noexcept;
+
+        [[nodiscard]] const std::string &actual() const noexcept;
+
+        [[nodiscard]] const std::string &message() const noexcept;
+
+        [[nodiscard]] ErrorCode errorCode() const noexcept;
+
+        /**
+         * Returns a copy of the ``Error``.
          *
-         * @param mustHave
+         * @important Only meaningful, if you have verified in advance that
+         *      there actually is an error. You can use ``isErr`` for this.
+         *
+         * @return
          */
-        void thisCase(Must mustHave) noexcept(false) {
-            if (m_testResults.empty()) {
-                return;
+        [[nodiscard]] Error error() const noexcept(false);
+
+        /**
+         * Returns a copy of the ``TestResult``.
+         *
+         * @important Only meaningful, if you have verified in advance
+         *      that there isn't an error present. You can use ``isErr`` for this.
+         *
+         * @return
+         */
+        [[nodiscard]] TestResult get() const noexcept(false);
+
+        operator Result() const noexcept(false);
+
+    private:
+        const TestResults *m_results;
+
+        size_t m_index;
+    };
+
+    /**
+     * A container of multiple test results.
+     *
+     * Results are stored in a compact, structure-of-arrays layout:
+     * Descriptions are stored once per ``it`` scope, and a passed assertion
+     * only takes up its case number, scope and status. Strings (expected,
+     * actual, messages, etc.) are only stored for the results which have them,
+     * which is typically only the failed ones.
+     */
+    class TestResults {
+    public:
+        class const_iterator {
+        public:
+            using iterator_category = std::input_iterator_tag;
+            using value_type = ResultRef;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = ResultRef;
+
+            const_iterator() = default;
+
+            const_iterator(const TestResults *results, size_t index) : m_results(results), m_index(index) {}
+
+            ResultRef operator*() const noexcept {
+                return {*m_results, m_index};
             }
-            Result res = m_testResults[m_testResults.size() - 1];
-            if (res.isErr()) {
-                Error err = res.error();
 
-                // When the test result holds an error, we will transform it to a ``TestResult``,
-                // which checks if we expected an error in this location.
-                m_testResults[m_testResults.size() - 1] = TestResult{
-                        .info = err.info,
-                        .passed = mustHave == Must::HaveCausedError,
-                };
-            } else {
-                TestResult result = res.get();
-                m_testResults[m_testResults.size() - 1] = TestResult{
-                        .info = result.info,
-                        .passed = (mustHave == Must::HavePassed && result.passed) || (mustHave == Must::HaveFailed && !result.passed),
-                        .expected = result.expected,
-                        .actual = result.actual,
-                };
+            const_iterator &operator++() noexcept {
+                ++m_index;
+                return *this;
             }
 
-            m_assertionsActive = AssertionState::Started;
-        }
+            const_iterator operator++(int) noexcept {
+                const_iterator copy = *this;
+                ++m_index;
+                return copy;
+            }
+
+            bool operator==(const const_iterator &other) const noexcept {
+                return m_index == other.m_index;
+            }
+
+        private:
+            const TestResults *m_results = nullptr;
+
+            size_t m_index = 0;
+        };
+
+        using iterator = const_iterator;
 
-    protected:
         /**
-         * Used for international communication between an assertion and
-         * the assertion handling logic.
+         * An ``it`` scope, which one or more results belong to.
          */
-        struct InternalResult {
+        struct Scope {
+            std::string description;
+
             /**
-             * If the assertion passed.
+             * Name of the test case.
              */
-            bool passed = false;
+            std::string testCase;
 
             /**
-             * Expected and actual values (as string)
+             * Time spent evaluating the scope.
              */
-            std::string expected, actual;
+            Timing timing;
+
+            /**
+             * Allocations made while evaluating the scope, when they're tracked
+             * (see ``BBUNIT_TRACK_ALLOCATIONS``).
+             */
+            AllocationCounts allocations;
+
+            /**
+             * Hardware events of the scope, when they're counted (see ``Settings::countHardwareEvents``).
+             */
+            Utilities::CounterValues counters;
+
+            /**
+             * Whether the scope was finished (see ``finishScope``). The parts of
+             * a scope handed to a sink before it finished are incomplete.
+             */
+            bool complete = false;
         };
 
         /**
-         * Helper method which casts an "unknown" type T to a string.
-         *
-         * A few different methods are included here, since there's no
-         * universal way of casting a value to a string.
-         *
-         * @tparam T
-         * @param input
-         * @return
+         * Time spent running a test case.
          */
-        template<typename T>
-        std::string castToString(T input) const noexcept {
-            if constexpr (std::is_convertible_v<T, std::string>) {
-                return static_cast<std::string>(input);
-            } else if constexpr (std::is_convertible_v<T, int> || std::is_convertible_v<T, float>) {
-                return std::to_string(input);
-            } else {
-                return {};
-            }
-        }
+        struct CaseTiming {
+            std::string testCase;
+            Timing timing;
 
-        /**
+            /**
+             * Whether every scope ran. Listing the scopes, filtering them, or
+             * exhausting the failure budget leaves some out.
+             */
+            bool complete = true;
+        };
+
+        TestResults() = default;
+
+        TestResults(std::initializer_list<Result> results) {
+            reserve(results.size());
+            for (const Result &result: results) {
+                push_back(result);
+            }
+        }
+
+        [[nodiscard]] size_t size() const noexcept {
+            return m_statuses.size();
+        }
+
+        [[nodiscard]] bool empty() const noexcept {
+            return m_statuses.empty();
+        }
+
+        [[nodiscard]] const_iterator begin() const noexcept {
+            return {this, 0};
+        }
+
+        [[nodiscard]] const_iterator end() const noexcept {
+            return {this, size()};
+        }
+
+        /**
+         * The result at ``index``.
+         *
+         * @throws std::out_of_range When there's no such result.
+         * @param index
+         * @return
+         */
+        ResultRef operator[](size_t index) const noexcept(false) {
+            if (index >= size()) {
+                throw std::out_of_range("No result #" + std::to_string(index) + " among " + std::to_string(size()));
+            }
+            return {*this, index};
+        }
+
+        /**
+         * Reserve room for a number of additional results.
+         *
+         * @param count
+         */
+        void reserve(size_t count) {
+            m_caseNos.reserve(count);
+            m_scopes.reserve(count);
+            m_statuses.reserve(count);
+            m_details.reserve(count);
+        }
+
+        /**
+         * Reserve room for merging all of ``parts`` into this container,
+         * so the merge doesn't have to grow the storage along the way.
+         *
+         * @param parts
+         */
+        void reserve(const std::vector<TestResults> &parts) {
+            size_t count = size(), scopes = m_scopeTable.size(), details = m_detailStore.size();
+            for (const TestResults &part: parts) {
+                count += part.size();
+                scopes += part.m_scopeTable.size();
+                details += part.m_detailStore.size();
+            }
+            reserve(count);
+            m_scopeTable.reserve(scopes);
+            m_detailStore.reserve(details);
+        }
+
+        void clear() noexcept {
+            m_scopeTable.clear();
+            m_timings.clear();
+            m_caseTimings.clear();
+            m_caseNos.clear();
+            m_scopes.clear();
+            m_statuses.clear();
+            m_details.clear();
+            m_detailStore.clear();
+        }
+
+        /**
+         * Remove the results from ``count`` onward. Scopes are kept.
+         *
+         * @param count
+         */
+        void truncate(size_t count) noexcept {
+            if (count >= size()) {
+                return;
+            }
+
+            // Details are appended as they're added, so the removed results own the
+            // details from the lowest one they refer to
+            uint32_t detail = NoDetail;
+            for (size_t i = count; i < size(); ++i) {
+                detail = std::min(detail, m_details[i]);
+            }
+            if (detail != NoDetail) {
+                m_detailStore.resize(detail);
+            }
+            m_caseNos.resize(count);
+            m_scopes.resize(count);
+            m_statuses.resize(count);
+            m_details.resize(count);
+            if (m_timings.size() > count) {
+                m_timings.resize(count);
+            }
+        }
+
+        /**
+         * Start a new ``it`` scope. Results added with ``addPassed``,
+         * ``addFailed`` and ``addError`` are attributed to it.
+         *
+         * @param description
+         * @param testCase Name of the test case the scope belongs to.
+         */
+        void beginScope(const std::string &description, const std::string &testCase = {}) {
+            m_scopeTable.push_back({.description = description, .testCase = testCase});
+        }
+
+        /**
+         * Complete the most recent scope, by providing the name of its test case
+         * and the time spent.
+         *
+         * @param testCase
+         * @param timing
+         * @param allocations
+         * @param counters
+         */
+        void finishScope(const std::string &testCase,
+                         Timing timing,
+                         const AllocationCounts &allocations = {},
+                         const Utilities::CounterValues &counters = {}) {
+            if (m_scopeTable.empty()) {
+                beginScope({});
+            }
+            m_scopeTable.back().testCase = testCase;
+            m_scopeTable.back().timing = timing;
+            m_scopeTable.back().allocations = allocations;
+            m_scopeTable.back().counters = counters;
+            m_scopeTable.back().complete = true;
+        }
+
+        /**
+         * The ``it`` scopes which the results belong to.
+         *
+         * @return
+         */
+        [[nodiscard]] const std::vector<Scope> &scopes() const noexcept {
+            return m_scopeTable;
+        }
+
+        /**
+         * Record the time spent running a test case.
+         *
+         * @param testCase
+         * @param timing
+         * @param complete Whether every scope ran
+         */
+        void addCaseTiming(const std::string &testCase, Timing timing, bool complete = true) {
+            m_caseTimings.push_back({testCase, timing, complete});
+        }
+
+        /**
+         * Time spent running each test case.
+         *
+         * @return
+         */
+        [[nodiscard]] const std::vector<CaseTiming> &caseTimings() const noexcept {
+            return m_caseTimings;
+        }
+
+        /**
+         * Record the time spent on an individual assertion.
+         *
+         * @param index
+         * @param timing
+         */
+        void setTiming(size_t index, Timing timing) {
+            if (m_timings.size() < size()) {
+                m_timings.resize(size());
+            }
+            m_timings[index] = timing;
+        }
+
+        /**
+         * Add a passed assertion to the current scope.
+         *
+         * @param caseNo
+         */
+        void addPassed(CaseNumber caseNo) {
+            add(caseNo, Status::Passed, NoDetail);
+        }
+
+        /**
+         * Add an assertion with expected and actual values to the current scope.
+         *
+         * @param caseNo
+         * @param passed
+         * @param expected
+         * @param actual
+         */
+        void addResult(CaseNumber caseNo, bool passed, std::string expected, std::string actual) {
+            if (passed && expected.empty() && actual.empty()) {
+                addPassed(caseNo);
+                return;
+            }
+            add(caseNo, passed ? Status::Passed : Status::Failed, storeDetail({
+                    .expected = std::move(expected),
+                    .actual = std::move(actual),
+            }));
+        }
+
+        /**
+         * Add an error to the current scope.
+         *
+         * @param caseNo
+         * @param errorCode
+         * @param message
+         */
+        void addError(CaseNumber caseNo, ErrorCode errorCode, std::string message = {}) {
+            add(caseNo, Status::Error, storeDetail({
+                    .errorCode = errorCode,
+                    .message = std::move(message),
+            }));
+        }
+
+        /**
+         * Add a ``TestResult`` or ``Error``.
+         *
+         * @param result
+         */
+        void push_back(const Result &result) {
+            const TestInfo &info = result.isErr() ? std::get<Error>(result).info : std::get<TestResult>(result).info;
+            if (m_scopeTable.empty() || m_scopeTable.back().description != info.description) {
+                beginScope(info.description);
+            }
+
+            if (result.isErr()) {
+                const Error &err = std::get<Error>(result);
+                addError(info.caseNo, err.errorCode, err.message);
+            } else {
+                const TestResult &res = std::get<TestResult>(result);
+                addResult(info.caseNo, res.passed, res.expected, res.actual);
+            }
+
+            if (!info.additional.empty()) {
+                setAdditional(size() - 1, info.additional);
+            }
+            if (info.timing.wall.count() || info.timing.cpu.count()) {
+                setTiming(size() - 1, info.timing);
+            }
+        }
+
+        template<typename... Args>
+        void emplace_back(Args &&...args) {
+            push_back(Result(std::forward<Args>(args)...));
+        }
+
+        /**
+         * Replace the result at the given position.
+         *
+         * @param index
+         * @param result
+         */
+        void set(size_t index, const Result &result) {
+            const TestInfo &info = result.isErr() ? std::get<Error>(result).info : std::get<TestResult>(result).info;
+            if (m_scopeTable[m_scopes[index]].description != info.description) {
+                Scope scope = {.description = info.description, .testCase = m_scopeTable[m_scopes[index]].testCase};
+                m_scopes[index] = static_cast<uint32_t>(m_scopeTable.size());
+                m_scopeTable.push_back(std::move(scope));
+            }
+            m_caseNos[index] = info.caseNo;
+            if (index < m_timings.size() || info.timing.wall.count() || info.timing.cpu.count()) {
+                setTiming(index, info.timing);
+            }
+
+            Detail detail{.additional = info.additional};
+            if (result.isErr()) {
+                const Error &err = std::get<Error>(result);
+                m_statuses[index] = Status::Error;
+                detail.errorCode = err.errorCode;
+                detail.message = err.message;
+            } else {
+                const TestResult &res = std::get<TestResult>(result);
+                m_statuses[index] = res.passed ? Status::Passed : Status::Failed;
+                detail.expected = res.expected;
+                detail.actual = res.actual;
+            }
+
+            if (m_details[index] != NoDetail) {
+                m_detailStore[m_details[index]] = std::move(detail);
+            } else if (m_statuses[index] != Status::Passed || !detail.empty()) {
+                m_details[index] = storeDetail(std::move(detail));
+            }
+        }
+
+        /**
+         * Attach additional information (see ``because``) to a result.
+         *
+         * @param index
+         * @param additional
+         */
+        void setAdditional(size_t index, const std::string &additional) {
+            if (m_details[index] == NoDetail) {
+                m_details[index] = storeDetail({});
+            }
+            m_detailStore[m_details[index]].additional = additional;
+        }
+
+        /**
+         * Easily append more results, on the form:
+         *
+         * ````cpp
+         * currentResults += newResults;
+         * ````
+         *
+         * @param other
+         */
+        void operator+=(const TestResults &other) {
+            TestResults copy = other;
+            *this += std::move(copy);
+        }
+
+        /**
+         * Append results by moving them, which leaves ``other`` empty.
+         * Strings are moved rather than copied.
+         *
+         * @param other
+         */
+        void operator+=(TestResults &&other) {
+            // Take over the storage wholesale, unless we've reserved more room
+            if (empty() && m_scopeTable.empty() && m_caseTimings.empty()
+                && m_caseNos.capacity() <= other.m_caseNos.capacity()) {
+                *this = std::move(other);
+                other.clear();
+                return;
+            }
+
+            auto scopeOffset = static_cast<uint32_t>(m_scopeTable.size());
+            auto detailOffset = static_cast<uint32_t>(m_detailStore.size());
+
+            m_scopeTable.insert(m_scopeTable.end(),
+                                  std::make_move_iterator(other.m_scopeTable.begin()),
+                                  std::make_move_iterator(other.m_scopeTable.end()));
+            m_detailStore.insert(m_detailStore.end(),
+                                 std::make_move_iterator(other.m_detailStore.begin()),
+                                 std::make_move_iterator(other.m_detailStore.end()));
+
+            m_caseNos.insert(m_caseNos.end(), other.m_caseNos.begin(), other.m_caseNos.end());
+            m_statuses.insert(m_statuses.end(), other.m_statuses.begin(), other.m_statuses.end());
+
+            size_t from = m_scopes.size();
+            if (!m_timings.empty() || !other.m_timings.empty()) {
+                m_timings.resize(from);
+                m_timings.insert(m_timings.end(), other.m_timings.begin(), other.m_timings.end());
+                m_timings.resize(from + other.size());
+            }
+            m_caseTimings.insert(m_caseTimings.end(),
+                                 std::make_move_iterator(other.m_caseTimings.begin()),
+                                 std::make_move_iterator(other.m_caseTimings.end()));
+
+            m_scopes.insert(m_scopes.end(), other.m_scopes.begin(), other.m_scopes.end());
+            m_details.insert(m_details.end(), other.m_details.begin(), other.m_details.end());
+            for (size_t i = from; i < m_scopes.size(); ++i) {
+                m_scopes[i] += scopeOffset;
+                if (m_details[i] != NoDetail) {
+                    m_details[i] += detailOffset;
+                }
+            }
+
+            other.clear();
+        }
+
+        /**
+         * Count the failed assertions and errors, from the given position onward.
+         * Errors caused by a previous failure (``ErrorCode::PrevAssertionFailed``)
+         * don't count.
+         *
+         * @param from
+         * @return
+         */
+        [[nodiscard]] size_t failures(size_t from = 0) const noexcept {
+            size_t count = 0;
+            for (size_t i = from; i < size(); ++i) {
+                count += m_statuses[i] == Status::Failed
+                         || (m_statuses[i] == Status::Error && m_detailStore[m_details[i]].errorCode != ErrorCode::PrevAssertionFailed);
+            }
+            return count;
+        }
+
+        /**
+         * Append the results to ``out`` in a compact binary format, which
+         * can be read back with ``deserialize`` by the same build.
+         *
+         * @param out
+         */
+        void serialize(std::string &out) const noexcept(false) {
+            Writer writer{out};
+            writer.count(m_scopeTable.size());
+            for (const Scope &scope: m_scopeTable) {
+                writer.string(scope.description);
+                writer.string(scope.testCase);
+                writer.raw(scope.timing);
+                writer.raw(scope.allocations);
+                writer.raw(scope.counters);
+                writer.raw(scope.complete);
+            }
+            writer.vector(m_timings);
+            writer.count(m_caseTimings.size());
+            for (const CaseTiming &caseTiming: m_caseTimings) {
+                writer.string(caseTiming.testCase);
+                writer.raw(caseTiming.timing);
+                writer.raw(caseTiming.complete);
+            }
+            writer.vector(m_caseNos);
+            writer.vector(m_scopes);
+            writer.vector(m_statuses);
+            writer.vector(m_details);
+            writer.count(m_detailStore.size());
+            for (const Detail &detail: m_detailStore) {
+                writer.raw(detail.errorCode);
+                writer.string(detail.additional);
+                writer.string(detail.expected);
+                writer.string(detail.actual);
+                writer.string(detail.message);
+            }
+        }
+
+        /**
+         * Read results written by ``serialize``.
+         *
+         * @throws std::runtime_error When the data is truncated.
+         * @param data
+         * @return
+         */
+        [[nodiscard]] static TestResults deserialize(std::string_view data) noexcept(false) {
+            Reader reader{data};
+            TestResults results;
+            results.m_scopeTable.resize(reader.count());
+            for (Scope &scope: results.m_scopeTable) {
+                scope.description = reader.string();
+                scope.testCase = reader.string();
+                reader.raw(scope.timing);
+                reader.raw(scope.allocations);
+                reader.raw(scope.counters);
+                reader.raw(scope.complete);
+            }
+            reader.vector(results.m_timings);
+            results.m_caseTimings.resize(reader.count());
+            for (CaseTiming &caseTiming: results.m_caseTimings) {
+                caseTiming.testCase = reader.string();
+                reader.raw(caseTiming.timing);
+                reader.raw(caseTiming.complete);
+            }
+            reader.vector(results.m_caseNos);
+            reader.vector(results.m_scopes);
+            reader.vector(results.m_statuses);
+            reader.vector(results.m_details);
+            results.m_detailStore.resize(reader.count());
+            for (Detail &detail: results.m_detailStore) {
+                reader.raw(detail.errorCode);
+                detail.additional = reader.string();
+                detail.expected = reader.string();
+                detail.actual = reader.string();
+                detail.message = reader.string();
+            }
+
+            size_t size = results.m_caseNos.size();
+            if (results.m_scopes.size() != size || results.m_statuses.size() != size || results.m_details.size() != size) {
+                throw std::runtime_error("Malformed test results");
+            }
+
+            return results;
+        }
+
+    private:
+        friend class ResultRef;
+
+        /**
+         * Helpers for ``serialize``.
+         */
+        struct Writer {
+            std::string &out;
+
+            template<typename T>
+            void raw(const T &value) {
+                static_assert(std::is_trivially_copyable_v<T>);
+                out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+            }
+
+            void count(size_t n) {
+                raw(static_cast<uint64_t>(n));
+            }
+
+            void string(const std::string &str) {
+                count(str.size());
+                out.append(str);
+            }
+
+            template<typename T>
+            void vector(const std::vector<T> &values) {
+                static_assert(std::is_trivially_copyable_v<T>);
+                count(values.size());
+                out.append(reinterpret_cast<const char *>(values.data()), values.size() * sizeof(T));
+            }
+        };
+
+        /**
+         * Helpers for ``deserialize``.
+         */
+        struct Reader {
+            std::string_view data;
+
+            std::string_view take(size_t size) {
+                if (size > data.size()) {
+                    throw std::runtime_error("Truncated test results");
+                }
+                std::string_view bytes = data.substr(0, size);
+                data.remove_prefix(size);
+                return bytes;
+            }
+
+            template<typename T>
+            void raw(T &value) {
+                static_assert(std::is_trivially_copyable_v<T>);
+                std::memcpy(&value, take(sizeof(T)).data(), sizeof(T));
+            }
+
+            size_t count() {
+                uint64_t n;
+                raw(n);
+                return static_cast<size_t>(n);
+            }
+
+            std::string string() {
+                return std::string(take(count()));
+            }
+
+            template<typename T>
+            void vector(std::vector<T> &values) {
+                size_t n = count();
+                if (n > data.size() / std::max<size_t>(sizeof(T), 1)) {
+                    throw std::runtime_error("Truncated test results");
+                }
+                values.resize(n);
+                // An empty vector's data may be null, which memcpy doesn't accept
+                if (n > 0) {
+                    std::memcpy(values.data(), take(n * sizeof(T)).data(), n * sizeof(T));
+                }
+            }
+        };
+
+        enum class Status : uint8_t {
+            Passed,
+            Failed,
+            Error,
+        };
+
+        /**
+         * The strings (and error code) which are only stored for the
+         * results which have them.
+         */
+        struct Detail {
+            ErrorCode errorCode = ErrorCode::ExceptionCaught;
+            std::string additional, expected, actual, message;
+
+            [[nodiscard]] bool empty() const noexcept {
+                return additional.empty() && expected.empty() && actual.empty() && message.empty();
+            }
+        };
+
+        static constexpr uint32_t NoDetail = UINT32_MAX;
+
+        /**
+         * The ``it`` scopes, stored once per scope.
+         */
+        std::vector<Scope> m_scopeTable;
+
+        /**
+         * Per-assertion timings. Empty, unless assertions are timed.
+         */
+        std::vector<Timing> m_timings;
+
+        std::vector<CaseTiming> m_caseTimings;
+
+        /**
+         * Per-result columns.
+         */
+        std::vector<CaseNumber> m_caseNos;
+        std::vector<uint32_t> m_scopes;
+        std::vector<Status> m_statuses;
+        std::vector<uint32_t> m_details;
+
+        std::vector<Detail> m_detailStore;
+
+        void add(CaseNumber caseNo, Status status, uint32_t detail) {
+            if (m_scopeTable.empty()) {
+                beginScope({});
+            }
+            m_caseNos.push_back(caseNo);
+            m_scopes.push_back(static_cast<uint32_t>(m_scopeTable.size() - 1));
+            m_statuses.push_back(status);
+            m_details.push_back(detail);
+        }
+
+        uint32_t storeDetail(Detail detail) {
+            m_detailStore.push_back(std::move(detail));
+            return static_cast<uint32_t>(m_detailStore.size() - 1);
+        }
+
+        [[nodiscard]] const Detail *detail(size_t index) const noexcept {
+            return m_details[index] == NoDetail ? nullptr : &m_detailStore[m_details[index]];
+        }
+
+        [[nodiscard]] static const std::string &none() noexcept {
+            static const std::string empty;
+            return empty;
+        }
+    };
+
+    inline bool ResultRef::isErr() const noexcept {
+        return m_results->m_statuses[m_index] == TestResults::Status::Error;
+    }
+
+    inline bool ResultRef::passed() const noexcept {
+        return m_results->m_statuses[m_index] == TestResults::Status::Passed;
+    }
+
+    inline CaseNumber ResultRef::caseNo() const noexcept {
+        return m_results->m_caseNos[m_index];
+    }
+
+    inline const std::string &ResultRef::description() const noexcept {
+        return m_results->m_scopeTable[m_results->m_scopes[m_index]].description;
+    }
+
+    inline const std::string &ResultRef::testCase() const noexcept {
+        return m_results->m_scopeTable[m_results->m_scopes[m_index]].testCase;
+    }
+
+    inline size_t ResultRef::scopeIndex() const noexcept {
+        return m_results->m_scopes[m_index];
+    }
+
+    inline Timing ResultRef::timing() const noexcept {
+        return m_index < m_results->m_timings.size() ? m_results->m_timings[m_index] : Timing{};
+    }
+
+    inline const std::string &ResultRef::additional() const noexcept {
+        auto detail = m_results->detail(m_index);
+        return detail ? detail->additional : TestResults::none();
+    }
+
+    inline const std::string &ResultRef::expected() const noexcept {
+        auto detail = m_results->detail(m_index);
+        return detail ? detail->expected : TestResults::none();
+    }
+
+    inline const std::string &ResultRef::actual() const noexcept {
+        auto detail = m_results->detail(m_index);
+        return detail ? detail->actual : TestResults::none();
+    }
+
+    inline const std::string &ResultRef::message() const noexcept {
+        auto detail = m_results->detail(m_index);
+        return detail ? detail->message : TestResults::none();
+    }
+
+    inline ErrorCode ResultRef::errorCode() const noexcept {
+        auto detail = m_results->detail(m_index);
+        return detail ? detail->errorCode : ErrorCode::ExceptionCaught;
+    }
+
+    inline Error ResultRef::error() const noexcept(false) {
+        return Error{
+                .info = {
+                        .caseNo = caseNo(),
+                        .description = description(),
+                        .additional = additional(),
+                        .timing = timing(),
+                },
+                .errorCode = errorCode(),
+                .message = message(),
+        };
+    }
+
+    inline TestResult ResultRef::get() const noexcept(false) {
+        return TestResult{
+                .info = {
+                        .caseNo = caseNo(),
+                        .description = description(),
+                        .additional = additional(),
+                        .timing = timing(),
+                },
+                .passed = passed(),
+                .expected = expected(),
+                .actual = actual(),
+        };
+    }
+
+    inline ResultRef::operator Result() const noexcept(false) {
+        if (isErr()) {
+            return error();
+        }
+        return get();
+    }
+
+    /**
+     * Receives results while the tests are running.
+     *
+     * Batches are delivered through ``push``, and the end of a run is
+     * signalled through ``finish``. Calls are serialized, so implementations
+     * don't need to be thread-safe, even when test cases run in parallel.
+     *
+     * @note When test cases run in parallel, batches from different test cases
+     *      arrive in the order they are produced, rather than the order the test
+     *      cases were provided in.
+     */
+    class ResultSink {
+    public:
+        virtual ~ResultSink() = default;
+
+        /**
+         * Hand a batch of results to the sink.
+         *
+         * @param results
+         */
+        void push(TestResults &&results) noexcept(false) {
+            if (results.empty() && results.scopes().empty() && results.caseTimings().empty()) {
+                return;
+            }
+            std::lock_guard<std::mutex> lock(m_mutex);
+            consume(std::move(results));
+        }
+
+        /**
+         * Signal that no more results will arrive as part of the current run.
+         */
+        void finish() noexcept(false) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            done();
+        }
+
+    protected:
+        /**
+         * Process a batch of results. The sink is free to move from it.
+         *
+         * @param results
+         */
+        virtual void consume(TestResults &&results) = 0;
+
+        /**
+         * Called when a run has completed.
+         */
+        virtual void done() {}
+
+    private:
+        std::mutex m_mutex;
+    };
+
+    /**
+     * Sink which collects all results in memory.
+     */
+    class ResultCollector : public ResultSink {
+    public:
+        /**
+         * The results collected so far.
+         *
+         * @return
+         */
+        [[nodiscard]] const TestResults &results() const noexcept {
+            return m_results;
+        }
+
+        /**
+         * Move the collected results out of the collector.
+         *
+         * @return
+         */
+        [[nodiscard]] TestResults take() noexcept {
+            TestResults results = std::move(m_results);
+            m_results.clear();
+            return results;
+        }
+
+    protected:
+        void consume(TestResults &&results) override {
+            m_results += std::move(results);
+        }
+
+    private:
+        TestResults m_results;
+    };
+
+    /**
+     * Sink which hands every batch to a number of other sinks, for example
+     * both the console printer and a report written to a file.
+     */
+    class TeeSink : public ResultSink {
+    public:
+        explicit TeeSink(std::vector<std::shared_ptr<ResultSink>> sinks) : m_sinks(std::move(sinks)) {}
+
+    protected:
+        void consume(TestResults &&results) override {
+            // All but the last sink get a copy, and the last one gets the original
+            for (size_t i = 0; i < m_sinks.size(); ++i) {
+                if (i + 1 < m_sinks.size()) {
+                    m_sinks[i]->push(TestResults(results));
+                } else {
+                    m_sinks[i]->push(std::move(results));
+                }
+            }
+        }
+
+        void done() override {
+            for (const std::shared_ptr<ResultSink> &sink: m_sinks) {
+                sink->finish();
+            }
+        }
+
+    private:
+        std::vector<std::shared_ptr<ResultSink>> m_sinks;
+    };
+
+    /**
+     * Trait to be used under ``TestCase``, whose primary purpose
+     * is to define the available assertion methods, as well as
+     * managing the assertion handling.
+     */
+    class ProvidesAssertions {
+    public:
+        /**
+         * Used in the library's self-testing.
+         */
+        enum class Must {
+            /**
+             * The assertion must have passed.
+             */
+            HavePassed,
+
+            /**
+             * The assertion is expected to have failed.
+             */
+            HaveFailed,
+
+            /**
+             * The assertion is expected to have caused an error,
+             * for example with trying to make assertions after a failed
+             * assert, or by throwing errors (such as ``std::bad_optional_access``).
+             */
+            HaveCausedError,
+        };
+
+        /**
+         * Provide additional descriptive information to a specific assertion.
+         *
+         * @param msg
+         * @return
+         */
+        ProvidesAssertions &because(const std::string &msg) noexcept(false) {
+            Allocations::Pause pause;
+            TestResults &testResults = context().testResults;
+            if (testResults.empty()) {
+                return *this;
+            }
+            testResults.setAdditional(testResults.size() - 1, msg);
+            return *this;
+        }
+
+        /**
+         * Used for the library's self-testing mechanism.
+         *
+         * It's appended to a specific assertion, and this method will then
+         * verify the result the assertion has produced. Furthermore, this
+         * method will adjust the results.
+         *
+         * For example, if an assertion is expected to have have a failed result.
+         * Let's say, if it needs to check that two integers are equals, and
+         * ``2`` and ``5`` were passed. In that case, the test fails.
+         * However, if that is the expected outcome as part of the self-test,
+         * this method will modify the ``TestResult`` to ensure correct reporting
+         * in the test results. Because, from the point-of-view of BBUnit,
+         * the test has actually passed.
+         *
+         * @param mustHave
+         */
+        void thisCase(Must mustHave) noexcept(false) {
+            Allocations::Pause pause;
+            TestResults &testResults = context().testResults;
+            if (testResults.empty()) {
+                return;
+            }
+            ResultRef res = testResults[testResults.size() - 1];
+            if (res.isErr()) {
+                Error err = res.error();
+
+                // When the test result holds an error, we will transform it to a ``TestResult``,
+                // which checks if we expected an error in this location.
+                testResults.set(testResults.size() - 1, TestResult{
+                        .info = err.info,
+                        .passed = mustHave == Must::HaveCausedError,
+                });
+            } else {
+                TestResult result = res.get();
+                testResults.set(testResults.size() - 1, TestResult{
+                        .info = result.info,
+                        .passed = (mustHave == Must::HavePassed && result.passed) || (mustHave == Must::HaveFailed && !result.passed),
+                        .expected = result.expected,
+                        .actual = result.actual,
+                });
+            }
+
+            context().state = AssertionState::Started;
+        }
+
+    protected:
+        /**
+         * Used for international communication between an assertion and
+         * the assertion handling logic.
+         */
+        struct InternalResult {
+            /**
+             * If the assertion passed.
+             */
+            bool passed = false;
+
+            /**
+             * Expected and actual values (as string)
+             */
+            std::string expected, actual;
+        };
+
+        /**
+         * Thrown by an assertion to skip the rest of the ``it`` scope, see
+         * ``Settings::skipScopeAfterFail`` and ``Settings::maxFailures``.
+         *
+         * It deliberately doesn't extend ``std::exception``, so it passes through
+         * ``catch (const std::exception &)`` blocks in the tests. It doesn't pass
+         * through ``catch (...)`` blocks, which must rethrow it (with ``throw;``)
+         * for the scope to be cut short.
+         */
+        struct ScopeAborted {};
+
+        /**
+         * Expected and actual values (as string), rendered by an assertion
+         * only when they are needed.
+         */
+        struct ExpectedActual {
+            std::string expected, actual;
+        };
+
+        /**
+         * Expected and actual values of a failed ``assertContainerEquals``, such as
+         * "4 elements" and "5 elements, 2 differences: [1] 7 (expected 2), [4] 1 (unexpected)".
+         *
+         * @param diff
+         * @return
+         */
+        static ExpectedActual describeDiff(const ContainerDiff &diff) noexcept(false) {
+            std::string actual = std::to_string(diff.actualSize) + " elements";
+            if (!diff.equal()) {
+                actual += ", " + std::to_string(diff.differences)
+                          + (diff.differences == 1 ? " difference: " : " differences: ");
+                for (size_t i = 0; i < diff.described.size(); ++i) {
+                    actual += (i > 0 ? ", " : "") + diff.described[i];
+                }
+                if (diff.differences > diff.described.size()) {
+                    actual += ", and " + std::to_string(diff.differences - diff.described.size()) + " more";
+                }
+            }
+            return {std::to_string(diff.expectedSize) + " elements", actual};
+        }
+
+        /**
+         * Helper method which casts an "unknown" type T to a string.
+         *
+         * The value is rendered by ``Formatter<T>``, which can be specialized
+         * for your own types.
+         *
+         * @tparam T
+         * @param input
+         * @return
+         */
+        template<typename T>
+        std::string castToString(const T &input) const noexcept(false) {
+            return Format::toString(input);
+        }
+
+        /**
          * Assert that two values are equal.
          *
          * @tparam T
@@ -364,167 +1641,695 @@ namespace BBUnit {
          * @param actual
          * @return
          */
-        template<Comparable T>
-        ProvidesAssertions &assertEquals(const T &expected, const T &actual) noexcept(false) {
-            assert([&]() -> InternalResult {
-                return {expected == actual, castToString(expected), castToString(actual)};
+        template<Comparable T>
+        ProvidesAssertions &assertEquals(const T &expected, const T &actual) noexcept(false) {
+            assert([&]() -> bool {
+                return expected == actual;
+            }, [&]() -> ExpectedActual {
+                return {castToString(expected), castToString(actual)};
+            });
+            return *this;
+        }
+
+        /**
+         * Assert that two values are not equal.
+         *
+         * @tparam T
+         * @param expected
+         * @param actual
+         * @return
+         */
+        template<Comparable T>
+        ProvidesAssertions &assertNotEquals(const T &expected, const T &actual) noexcept(false) {
+            assert([&]() -> bool {
+                return expected != actual;
+            }, [&]() -> ExpectedActual {
+                return {castToString(expected), castToString(actual)};
+            });
+            return *this;
+        }
+
+        /**
+         * Assert the number of elements in an object match the expectation.
+         *
+         * The class must contain a ``size`` method (which returns ``size_t``).
+         *
+         * Typical subjects include ``std::vector``, ``std::map`` and ``std:.array``.
+         *
+         * @tparam T
+         * @param expected
+         * @param iter
+         * @return
+         */
+        template<HasSizeMethod T>
+        ProvidesAssertions &assertCount(size_t expected, const T &iter) noexcept(false) {
+            assert([&]() -> bool {
+                return expected == iter.size();
+            }, [&]() -> ExpectedActual {
+                return {std::to_string(static_cast<size_t>(expected)),
+                        std::to_string(static_cast<size_t>(iter.size()))};
+            });
+            return *this;
+        }
+
+        /**
+         * Assert that the subject satisfies the regular expression pattern.
+         *
+         * The compiled pattern is kept in the ``regexCache`` of the settings (when
+         * there is one), so each pattern is only compiled once.
+         *
+         * @param pattern
+         * @param subject
+         * @param flags
+         * @return
+         */
+        ProvidesAssertions &assertRegex(const std::string &pattern,
+                                        const std::string &subject,
+                                        std::regex::flag_type flags = std::regex::ECMAScript) noexcept(false) {
+            assert([&]() -> bool {
+                std::shared_ptr<const std::regex> compiled;
+                {
+                    // The cache outlives the scope, so its entries aren't the test's allocations
+                    Allocations::Pause pause;
+                    compiled = m_settings.regexCache
+                               ? m_settings.regexCache->get(pattern, flags)
+                               : std::make_shared<const std::regex>(pattern, flags);
+                }
+                return std::regex_search(subject, *compiled);
+            }, [&]() -> ExpectedActual {
+                return {pattern, subject};
+            });
+            return *this;
+        }
+
+        /**
+         * Assert that the subject satisfies a precompiled regular expression.
+         *
+         * @param pattern
+         * @param subject
+         * @return
+         */
+        ProvidesAssertions &assertRegex(const std::regex &pattern,
+                                        const std::string &subject) noexcept(false) {
+            assert([&]() -> bool {
+                return std::regex_search(subject, pattern);
+            }, [&]() -> ExpectedActual {
+                return {"<Precompiled pattern>", subject};
+            });
+            return *this;
+        }
+
+        /**
+         * Short-hand method to assert that a value is true.
+         *
+         * @param actual
+         * @return
+         */
+        ProvidesAssertions &assertTrue(bool actual) noexcept(false) {
+            assert([&]() -> bool {
+                return actual;
+            }, []() -> ExpectedActual {
+                return {"true", "false"};
+            });
+            return *this;
+        }
+
+        /**
+         * Short-hand method to assert that a value is false.
+         * @param actual
+         * @return
+         */
+        ProvidesAssertions &assertFalse(bool actual) noexcept(false) {
+            assert([&]() -> bool {
+                return !actual;
+            }, []() -> ExpectedActual {
+                return {"false", "true"};
+            });
+            return *this;
+        }
+
+        /**
+         * Assert that an exception is thrown.
+         *
+         * Optionally, you can also verify that the exception contains a specific message.
+         *
+         * @tparam T
+         * @tparam F
+         * @param func
+         * @param message
+         * @return
+         */
+        template<HasWhatMethod T, std::invocable F>
+        ProvidesAssertions &assertException(F &&func,
+                                            const std::optional<std::string> &message = std::nullopt) noexcept(false) {
+            assert([&]() -> InternalResult {
+                try {
+                    func();
+                } catch (const ScopeAborted &) {
+                    // A failed assertion within ``func`` cuts the scope short
+                    throw;
+                } catch (T &e) {
+                    return !message.has_value()
+                                   ? InternalResult{true}
+                                   : InternalResult{message.value() == e.what(), message.value(), e.what()};
+                } catch (std::exception &e) {
+                    // When another type of exception is thrown, we will attempt to
+                    // get a hold of its name, so we can populate a more useful message
+                    // to the result feed.
+                    return {false, getClassName(T()), getClassName(e)};
+                } catch (...) {
+                    return {false, getClassName(T()), "<Unknown exception>"};
+                }
+                // No exception thrown
+                return {false, getClassName(T()), "<No exception thrown>"};
+            });
+            return *this;
+        }
+
+        /**
+         * Assert that a ``std::optional`` contains a specific value.
+         *
+         * Evaluation is safe, and will not crash if the optional has no value.
+         *
+         * @tparam T
+         * @param expected
+         * @param actual
+         * @return
+         */
+        template<typename T>
+        ProvidesAssertions &assertEquals(const T &expected,
+                                         const std::optional<T> &actual) {
+            assert([&]() -> bool {
+                return actual.has_value() && actual.value() == expected;
+            }, [&]() -> ExpectedActual {
+                if (!actual.has_value()) {
+                    return {castToString(expected), "<No value>"};
+                }
+                return {castToString(expected), castToString(actual.value())};
+            });
+            return *this;
+        }
+
+        /**
+         * Assert that a ``std::optional`` does not contain a value.
+         *
+         * @tparam T
+         * @param actual
+         * @return
+         */
+        template<typename T>
+        ProvidesAssertions &assertEmpty(const std::optional<T> &actual) {
+            assert([&]() -> bool {
+                return !actual.has_value();
+            }, [&]() -> ExpectedActual {
+                return {"<No value>",
+                        actual.has_value() ? castToString(actual.value()) : "<No value>"};
+            });
+            return *this;
+        }
+
+        /**
+         * Assert that two floating-point values are equal within a tolerance:
+         *
+         * ````cpp
+         * assertNear(0.3, 0.1 + 0.2, {.absolute = 1e-12});
+         * ````
+         *
+         * @tparam T
+         * @param expected
+         * @param actual
+         * @param tolerance
+         * @return
+         */
+        template<std::floating_point T>
+        ProvidesAssertions &assertNear(T expected, T actual, const Tolerance &tolerance) noexcept(false) {
+            assert([&]() -> bool {
+                return Numeric::near(expected, actual, tolerance);
+            }, [&]() -> ExpectedActual {
+                return {Numeric::format(expected) + " (" + tolerance.describe() + ")",
+                        Numeric::format(actual) + " (error " + Numeric::format(std::abs(actual - expected)) + ")"};
             });
             return *this;
         }
 
         /**
-         * Assert that two values are not equal.
+         * Assert that two arrays of floating-point values, such as ``std::vector<float>``,
+         * ``std::array`` or ``std::span``, have the same size, and are equal element by
+         * element within a tolerance.
          *
-         * @tparam T
+         * A failure reports the number of mismatches, the first one, and the largest
+         * error, rather than the contents of the arrays.
+         *
+         * @tparam E
+         * @tparam A
          * @param expected
          * @param actual
+         * @param tolerance
          * @return
          */
-        template<Comparable T>
-        ProvidesAssertions &assertNotEquals(const T &expected, const T &actual) noexcept(false) {
-            assert([&]() -> InternalResult {
-                return {expected != actual, castToString(expected), castToString(actual)};
+        template<std::ranges::contiguous_range E, std::ranges::contiguous_range A>
+        requires std::floating_point<std::ranges::range_value_t<E>>
+                 && std::same_as<std::ranges::range_value_t<E>, std::ranges::range_value_t<A>>
+        ProvidesAssertions &assertAllClose(const E &expected, const A &actual, const Tolerance &tolerance) noexcept(false) {
+            using T = std::ranges::range_value_t<E>;
+            std::span<const T> e(std::ranges::data(expected), std::ranges::size(expected));
+            std::span<const T> a(std::ranges::data(actual), std::ranges::size(actual));
+
+            Closeness closeness;
+            assert([&]() -> bool {
+                if (e.size() != a.size()) {
+                    return false;
+                }
+                closeness = Numeric::compare(e, a, tolerance);
+                return closeness.passed();
+            }, [&]() -> ExpectedActual {
+                if (e.size() != a.size()) {
+                    return {std::to_string(e.size()) + " elements", std::to_string(a.size()) + " elements"};
+                }
+                auto at = [&](size_t i) {
+                    return "[" + std::to_string(i) + "] " + Numeric::format(a[i]) + " (expected " + Numeric::format(e[i]) + ")";
+                };
+                std::string expectedText = "All " + std::to_string(e.size()) + " elements within " + tolerance.describe();
+                if (closeness.passed()) {
+                    return {expectedText, expectedText};
+                }
+                return {expectedText,
+                        std::to_string(closeness.mismatches) + " mismatches, first at " + at(closeness.firstMismatch)
+                        + ", max error " + Numeric::format(closeness.maxError) + " at " + at(closeness.maxErrorIndex)};
             });
             return *this;
         }
 
         /**
-         * Assert the number of elements in an object match the expectation.
-         *
-         * The class must contain a ``size`` method (which returns ``size_t``).
+         * Assert that two sequences, such as a ``std::vector`` and a ``std::array``,
+         * hold equal elements in the same order.
          *
-         * Typical subjects include ``std::vector``, ``std::map`` and ``std:.array``.
+         * A failure describes the first few differing elements (see ``DiffOptions``),
+         * rather than the contents of the containers.
          *
-         * @tparam T
+         * @tparam E
+         * @tparam A
          * @param expected
-         * @param iter
+         * @param actual
+         * @param options
          * @return
          */
-        template<HasSizeMethod T>
-        ProvidesAssertions &assertCount(size_t expected, const T &iter) noexcept(false) {
-            assert([&]() -> InternalResult {
-                return {expected == iter.size(),
-                        std::to_string(static_cast<size_t>(expected)),
-                        std::to_string(static_cast<size_t>(iter.size()))};
+        template<std::ranges::forward_range E, std::ranges::forward_range A>
+        requires (!MapLike<E>) && Comparable<std::ranges::range_value_t<E>>
+                 && std::same_as<std::ranges::range_value_t<E>, std::ranges::range_value_t<A>>
+        ProvidesAssertions &assertContainerEquals(const E &expected,
+                                                  const A &actual,
+                                                  const DiffOptions &options = {}) noexcept(false) {
+            ContainerDiff diff;
+            assert([&]() -> bool {
+                diff = Diff::sequences(expected, actual, options);
+                return diff.equal();
+            }, [&]() -> ExpectedActual {
+                return describeDiff(diff);
             });
             return *this;
         }
 
         /**
-         * Assert that the subject satisfies the regular expression pattern.
+         * Assert that two maps, such as ``std::map`` or ``std::unordered_map``, hold
+         * the same keys with equal values.
          *
-         * @param pattern
-         * @param subject
+         * A failure describes the first few differing keys (see ``DiffOptions``).
+         *
+         * @tparam M
+         * @param expected
+         * @param actual
+         * @param options
          * @return
          */
-        ProvidesAssertions &assertRegex(const std::string &pattern,
-                                        const std::string &subject) noexcept(false) {
-            assert([&]() -> InternalResult {
-                return {std::regex_search(subject, std::regex(pattern)),
-                        pattern,
-                        subject};
+        template<MapLike M>
+        ProvidesAssertions &assertContainerEquals(const M &expected,
+                                                  const M &actual,
+                                                  const DiffOptions &options = {}) noexcept(false) {
+            ContainerDiff diff;
+            assert([&]() -> bool {
+                diff = Diff::maps(expected, actual, options);
+                return diff.equal();
+            }, [&]() -> ExpectedActual {
+                return describeDiff(diff);
             });
             return *this;
         }
 
         /**
-         * Short-hand method to assert that a value is true.
+         * Assert that two buffers, such as ``std::vector<uint8_t>`` or a span of
+         * ``std::byte``, hold the same bytes.
+         *
+         * A failure shows a hexadecimal dump of the bytes around the first difference,
+         * with ``DiffOptions::context`` bytes on each side.
          *
+         * @tparam E
+         * @tparam A
+         * @param expected
          * @param actual
+         * @param options
          * @return
          */
-        ProvidesAssertions &assertTrue(bool actual) noexcept(false) {
-            assert([&]() -> InternalResult {
-                return {actual, "true", "false"};
+        template<std::ranges::contiguous_range E, std::ranges::contiguous_range A>
+        requires std::is_trivially_copyable_v<std::ranges::range_value_t<E>>
+                 && std::is_trivially_copyable_v<std::ranges::range_value_t<A>>
+        ProvidesAssertions &assertBytesEqual(const E &expected,
+                                             const A &actual,
+                                             const DiffOptions &options = {}) noexcept(false) {
+            auto e = std::as_bytes(std::span(std::ranges::data(expected), std::ranges::size(expected)));
+            auto a = std::as_bytes(std::span(std::ranges::data(actual), std::ranges::size(actual)));
+
+            ByteDiff diff;
+            assert([&]() -> bool {
+                diff = Diff::bytes(e, a);
+                return diff.equal();
+            }, [&]() -> ExpectedActual {
+                return {std::to_string(e.size()) + " bytes; "
+                        + Diff::hexdump(e, a, diff.firstDifference, options.context),
+                        std::to_string(a.size()) + " bytes, " + std::to_string(diff.differences)
+                        + " differ from " + Diff::address(diff.firstDifference) + "; "
+                        + Diff::hexdump(a, e, diff.firstDifference, options.context)};
             });
             return *this;
         }
 
         /**
-         * Short-hand method to assert that a value is false.
-         * @param actual
+         * Assert that ``func`` makes no allocations through ``operator new``
+         * on the calling thread.
+         *
+         * @throws std::logic_error When allocations aren't tracked (see ``BBUNIT_TRACK_ALLOCATIONS``).
+         * @tparam F
+         * @param func
          * @return
          */
-        ProvidesAssertions &assertFalse(bool actual) noexcept(false) {
-            assert([&]() -> InternalResult {
-                return {!actual, "false", "true"};
+        template<std::invocable F>
+        ProvidesAssertions &assertNoAllocations(F &&func) noexcept(false) {
+            return assertAllocationsAtMost(0, std::forward<F>(func));
+        }
+
+        /**
+         * Assert that ``func`` makes at most ``limit`` allocations through
+         * ``operator new`` on the calling thread.
+         *
+         * @throws std::logic_error When allocations aren't tracked (see ``BBUNIT_TRACK_ALLOCATIONS``).
+         * @tparam F
+         * @param limit
+         * @param func
+         * @return
+         */
+        template<std::invocable F>
+        ProvidesAssertions &assertAllocationsAtMost(uint64_t limit, F &&func) noexcept(false) {
+            AllocationCounts counts;
+            assert([&]() -> bool {
+                if (!Allocations::enabled()) {
+                    throw std::logic_error("Allocations aren't tracked. Define BBUNIT_TRACK_ALLOCATIONS in one source file.");
+                }
+                counts = Allocations::measure(func);
+                return counts.allocations <= limit;
+            }, [&]() -> ExpectedActual {
+                return {limit == 0 ? "No allocations" : "At most " + std::to_string(limit) + " allocations",
+                        std::to_string(counts.allocations) + " allocations (" + std::to_string(counts.bytes) + " bytes)"};
             });
             return *this;
         }
 
         /**
-         * Assert that an exception is thrown.
+         * Assert that a call of ``func`` retires at most ``limit`` instructions on
+         * the calling thread, counted with the hardware performance counters.
          *
-         * Optionally, you can also verify that the exception contains a specific message.
+         * Instruction counts are far more stable than durations, which makes them
+         * suited for catching regressions on shared CI machines. Where the counters
+         * aren't available, the assertion passes, with the reason attached.
          *
-         * @tparam T
+         * @tparam F
+         * @param limit
          * @param func
-         * @param message
          * @return
          */
-        template<HasWhatMethod T>
-        ProvidesAssertions &assertException(const std::function<void()> &func,
-                                            const std::optional<std::string> &message = std::nullopt) noexcept(false) {
-            assert([&]() -> InternalResult {
-                try {
-                    func();
-                } catch (T &e) {
-                    return !message.has_value()
-                                   ? InternalResult{true}
-                                   : InternalResult{message.value() == e.what(), message.value(), e.what()};
-                } catch (std::exception &e) {
-                    // When another type of exception is thrown, we will attempt to
-                    // get a hold of its name, so we can populate a more useful message
-                    // to the result feed.
-                    return {false, getClassName(T()), getClassName(e)};
-                } catch (...) {
-                    return {false, getClassName(T()), "<Unknown exception>"};
-                }
-                // No exception thrown
-                return {false, getClassName(T()), "<No exception thrown>"};
+        template<std::invocable F>
+        ProvidesAssertions &assertInstructionsAtMost(uint64_t limit, F &&func) noexcept(false) {
+            std::optional<Utilities::CounterValues> counters;
+            assert([&]() -> bool {
+                Utilities::CounterValues start = Utilities::PerfCounters::read();
+                func();
+                counters = Utilities::PerfCounters::read().since(start);
+                return !counters->has(Utilities::PerfCounters::Instructions) || counters->instructions <= limit;
+            }, [&]() -> ExpectedActual {
+                return {"At most " + std::to_string(limit) + " instructions",
+                        std::to_string(counters->instructions) + " instructions ("
+                        + std::to_string(counters->cycles) + " cycles)"};
+            });
+            return notMeasured(counters);
+        }
+
+        /**
+         * Assert that a benchmark retires at most ``limit`` instructions per call
+         * on average. Where the counters aren't available, the assertion passes,
+         * with the reason attached.
+         *
+         * @param stats
+         * @param limit
+         * @return
+         */
+        ProvidesAssertions &assertInstructionsAtMost(const BenchmarkStats &stats, double limit) noexcept(false) {
+            std::optional<Utilities::CounterValues> counters;
+            assert([&]() -> bool {
+                counters = stats.counters;
+                return !stats.counters.has(Utilities::PerfCounters::Instructions)
+                       || stats.perCall(stats.counters.instructions) <= limit;
+            }, [&]() -> ExpectedActual {
+                return {"At most " + Format::toString(limit) + " instructions per call", stats.summary()};
+            });
+            return notMeasured(counters);
+        }
+
+        /**
+         * Assert that the median duration of a benchmark is below a limit.
+         *
+         * @param stats
+         * @param limit
+         * @return
+         */
+        ProvidesAssertions &assertFasterThan(const BenchmarkStats &stats,
+                                             std::chrono::nanoseconds limit) noexcept(false) {
+            assert([&]() -> bool {
+                return stats.median < limit;
+            }, [&]() -> ExpectedActual {
+                return {"median < " + BenchmarkStats::formatDuration(static_cast<double>(limit.count())),
+                        stats.summary()};
             });
             return *this;
         }
 
         /**
-         * Assert that a ``std::optional`` contains a specific value.
+         * Assert that a benchmark is no slower than its median in the baseline
+         * (see ``Settings::benchmarkBaseline``), allowing for some tolerance.
          *
-         * Evaluation is safe, and will not crash if the optional has no value.
+         * When the benchmark isn't in the baseline yet, the assertion passes,
+         * and the measurement is added to the baseline.
          *
-         * @tparam T
-         * @param expected
-         * @param actual
+         * @param stats
+         * @param tolerance Allowed slow-down, relative to the baseline. For example, ``0.1`` for 10%.
          * @return
          */
-        template<typename T>
-        ProvidesAssertions &assertEquals(const T &expected,
-                                         const std::optional<T> &actual) {
-            assert([&]() -> InternalResult {
-                if (!actual.has_value()) {
-                    return {false, castToString(expected), "<No value>"};
-                }
-                return {actual.value() == expected, castToString(expected), castToString(actual.value())};
+        ProvidesAssertions &assertNoSlowerThanBaseline(const BenchmarkStats &stats,
+                                                       double tolerance = 0.1) noexcept(false) {
+            const std::shared_ptr<BenchmarkBaseline> &baseline = m_settings.benchmarkBaseline;
+            std::optional<BenchmarkDuration> median = baseline ? baseline->find(stats.description) : std::nullopt;
+
+            auto limit = [&]() {
+                return median->count() * (1.0 + tolerance);
+            };
+
+            bool evaluated = false;
+            assert([&]() -> bool {
+                evaluated = true;
+                return !median.has_value() || stats.median.count() <= limit();
+            }, [&]() -> ExpectedActual {
+                return {"median <= " + BenchmarkStats::formatDuration(limit())
+                                + " (baseline " + BenchmarkStats::formatDuration(median->count())
+                                + " + " + std::to_string(static_cast<int>(std::lround(tolerance * 100))) + "%)",
+                        stats.summary()};
             });
+
+            // A skipped assertion (see ``Settings::stopAssertingAfterFail``) neither
+            // adds to the baseline, nor describes the result it was skipped for
+            if (evaluated && !median.has_value()) {
+                if (baseline) {
+                    baseline->set(stats.description, stats.median);
+                }
+                because("No baseline");
+            }
             return *this;
         }
 
         /**
-         * Assert that a ``std::optional`` does not contain a value.
+         * Assert that a property holds for random inputs from the generators,
+         * for example that reversing a vector twice gives the original vector:
          *
-         * @tparam T
-         * @param actual
+         * ````cpp
+         * forAll(Generators::Vectors(Generators::Integers<int>()), [](const std::vector<int> &v) {
+         *     return reversed(reversed(v)) == v;
+         * });
+         * ````
+         *
+         * The predicate is called with a value from each generator, and returns
+         * whether the property holds. When it doesn't, the input is shrunk to a
+         * minimal counterexample, which is reported as the actual value, along
+         * with the seed reproducing it (see ``PropertyOptions::seed``).
+         *
+         * The property is checked as described by ``Settings::propertyOptions``, or
+         * by a ``PropertyOptions`` given as first argument.
+         *
+         * @tparam Args
+         * @param args Options (optional), generators and the predicate.
          * @return
          */
-        template<typename T>
-        ProvidesAssertions &assertEmpty(const std::optional<T> &actual) {
-            assert([&]() -> InternalResult {
-                return {!actual.has_value(),
-                        "<No value>",
-                        actual.has_value() ? castToString(actual.value()) : "<No value>"};
+        template<typename... Args>
+        ProvidesAssertions &forAll(Args &&...args) noexcept(false) {
+            static_assert(sizeof...(Args) >= 2, "forAll takes one or more generators, and a predicate.");
+            auto arguments = std::forward_as_tuple(std::forward<Args>(args)...);
+            using First = std::remove_cvref_t<std::tuple_element_t<0, decltype(arguments)>>;
+            constexpr size_t skip = std::is_same_v<First, PropertyOptions> ? 1 : 0;
+
+            const PropertyOptions *options = &m_settings.propertyOptions;
+            if constexpr (skip) {
+                options = &std::get<0>(arguments);
+            }
+
+            PropertyOutcome outcome;
+            assert([&]() -> bool {
+                outcome = [&]<size_t... I>(std::index_sequence<I...>) {
+                    return Property::check(*options,
+                                           std::get<sizeof...(Args) - 1>(arguments),
+                                           std::get<skip + I>(arguments)...);
+                }(std::make_index_sequence<sizeof...(Args) - 1 - skip>());
+                return outcome.passed;
+            }, [&]() -> ExpectedActual {
+                std::string expected = "Holds for " + std::to_string(options->iterations)
+                                       + " inputs (seed " + std::to_string(outcome.seed) + ")";
+                if (outcome.passed) {
+                    return {expected, expected};
+                }
+                std::string actual = "Fails for " + outcome.counterexample
+                                     + " after " + std::to_string(outcome.tests) + " inputs"
+                                     + " and " + std::to_string(outcome.shrinks) + " shrinks";
+                if (!outcome.error.empty()) {
+                    actual += ", throwing: " + outcome.error;
+                }
+                return {expected, actual};
+            });
+            return *this;
+        }
+
+        /**
+         * Run ``func`` for a row of a data-driven scope (see ``TestCase::itEach``).
+         *
+         * The results of a passing row are discarded. The results of a failing
+         * row are kept, with the row number and its values as additional
+         * information. Every row starts with a clean slate, so a failure
+         * doesn't stop the assertions of the next rows.
+         *
+         * @tparam Row
+         * @tparam F
+         * @param index
+         * @param row
+         * @param func
+         * @return True, if the row passed.
+         */
+        template<typename Row, typename F>
+        bool checkRow(size_t index, const Row &row, F &func) noexcept(false) {
+            AssertionContext &ctx = context();
+            size_t from = ctx.testResults.size();
+            ctx.caseNo = 0;
+            ctx.state = AssertionState::Started;
+
+            bool aborted = false;
+            try {
+                func(row);
+            } catch (const ScopeAborted &) {
+                aborted = true;
+            } catch (const std::exception &e) {
+                Allocations::Pause pause;
+                ctx.testResults.addError(++ctx.caseNo, ErrorCode::ExceptionCaught, e.what());
+            } catch (...) {
+                Allocations::Pause pause;
+                ctx.testResults.addError(++ctx.caseNo, ErrorCode::ExceptionCaught, "Unknown exception.");
+            }
+
+            // The bookkeeping of the results doesn't count as allocations of the tests
+            Allocations::Pause pause;
+
+            // Results handed to the sink halfway through the row have left the container
+            from = std::min(from, ctx.testResults.size());
+            if (ctx.testResults.failures(from) == 0 && !aborted) {
+                ctx.testResults.truncate(from);
+                return true;
+            }
+
+            std::string label = "Row " + std::to_string(index);
+            std::string values = Property::describe(row);
+            if (values != "<Value>") {
+                label += ": " + values;
+            }
+            for (size_t i = from; i < ctx.testResults.size(); ++i) {
+                const std::string &additional = ctx.testResults[i].additional();
+                ctx.testResults.setAdditional(i, additional.empty() ? label : label + " - " + additional);
+            }
+
+            if (aborted) {
+                throw ScopeAborted();
+            }
+            return false;
+        }
+
+        /**
+         * Record the outcome of a data-driven scope, as a single assertion
+         * that all rows passed.
+         *
+         * @param rows
+         * @param failedRows
+         */
+        void reportRows(size_t rows, size_t failedRows) noexcept(false) {
+            context().state = AssertionState::Started;
+            assert([&]() -> bool {
+                return failedRows == 0;
+            }, [&]() -> ExpectedActual {
+                return {"All " + std::to_string(rows) + " rows pass",
+                        std::to_string(failedRows) + " of " + std::to_string(rows) + " rows fail"};
             });
+        }
+
+        /**
+         * Attach why instructions weren't counted to the result of an assertion
+         * on them. Assertions which were skipped have no ``counters``.
+         *
+         * @param counters
+         * @return
+         */
+        ProvidesAssertions &notMeasured(const std::optional<Utilities::CounterValues> &counters) noexcept(false) {
+            if (counters && !counters->has(Utilities::PerfCounters::Instructions)) {
+                std::string reason = Utilities::PerfCounters::unavailableReason();
+                because("Not measured: hardware counters are unavailable" + (reason.empty() ? "" : " (" + reason + ")"));
+            }
             return *this;
         }
 
+        /**
+         * Record the measurement of a benchmark as a passed result, with the
+         * statistics as additional information.
+         *
+         * @param stats
+         */
+        void reportBenchmark(const BenchmarkStats &stats) noexcept(false) {
+            assert([]() -> bool {
+                return true;
+            }, []() -> ExpectedActual {
+                return {};
+            });
+            because(stats.summary());
+        }
+
         /**
          * Helper method to extract the class name of an object.
          *
@@ -544,19 +2349,25 @@ namespace BBUnit {
          * Start a new ``it`` scope (which can hold one or several assertions).
          *
          * @param description
+         * @param testCase Name of the test case.
+         * @param spillTo Buffer to flush through, when streaming to a sink.
          */
-        void start(const std::string &description) noexcept {
-            m_caseNo = 0;
-            m_testResults.clear();
-            m_description = description;
-            m_assertionsActive = AssertionState::Started;
+        void start(const std::string &description,
+                   const std::string &testCase = {},
+                   TestResults *spillTo = nullptr) noexcept {
+            AssertionContext &ctx = context();
+            ctx.spillTo = spillTo && m_settings.sink ? spillTo : nullptr;
+            ctx.caseNo = 0;
+            ctx.testResults.clear();
+            ctx.testResults.beginScope(description, testCase);
+            ctx.state = AssertionState::Started;
         }
 
         /**
          * End of ``it`` scope.
          */
         void end() noexcept {
-            m_assertionsActive = AssertionState::NotStarted;
+            context().state = AssertionState::NotStarted;
         }
 
         /**
@@ -565,7 +2376,16 @@ namespace BBUnit {
          * @return
          */
         [[nodiscard]] TestResults getResults() const noexcept {
-            return m_testResults;
+            return context().testResults;
+        }
+
+        /**
+         * Move the computed test results out of the current scope.
+         *
+         * @return
+         */
+        [[nodiscard]] TestResults takeResults() noexcept {
+            return std::move(context().testResults);
         }
 
         /**
@@ -578,6 +2398,53 @@ namespace BBUnit {
             m_settings = settings;
         }
 
+        /**
+         * Number of failed assertions and errors, which have been counted
+         * since the test case started running.
+         *
+         * @return
+         */
+        size_t &failureCount() noexcept {
+            return m_failures;
+        }
+
+        /**
+         * The settings used for assertions.
+         *
+         * @return
+         */
+        [[nodiscard]] const Settings &getSettings() const noexcept {
+            return m_settings;
+        }
+
+        /**
+         * Run ``func`` with an assertion context of its own, instead of the
+         * shared one. This makes it possible to run multiple ``it`` scopes
+         * of the same test case on separate threads at the same time.
+         *
+         * The context only applies to the calling thread, and only while
+         * ``func`` is running.
+         *
+         * @param func
+         */
+        template<std::invocable F>
+        void withOwnContext(F &&func) noexcept(false) {
+            AssertionContext own;
+            ActiveContext &active = activeContext();
+            ActiveContext previous = active;
+            active = {this, &own};
+
+            // Restore the previous context, also when ``func`` throws.
+            struct Restore {
+                ActiveContext &active, previous;
+                ~Restore() {
+                    active = previous;
+                }
+            } restore{active, previous};
+
+            func();
+        }
+
     private:
         /**
          * Used to keep track of whether an assertion has failed, and
@@ -610,64 +2477,230 @@ namespace BBUnit {
         Settings m_settings;
 
         /**
-         * The ``it`` scope's description/headline.
+         * See ``failureCount``.
+         */
+        size_t m_failures = 0;
+
+        /**
+         * State of the ``it`` scope which is currently being evaluated.
          */
-        std::string m_description;
+        struct AssertionContext {
+            /**
+             * Current case number (within ``it`` scope)
+             */
+            CaseNumber caseNo = 0;
+
+            /**
+             * Temporary container of test results, which will be cleared
+             * before/after starting a new round of assertions (i.e. entering an
+             * ``it`` scope).
+             */
+            TestResults testResults;
+
+            /**
+             * Current state of assertions.
+             */
+            AssertionState state = AssertionState::NotStarted;
+
+            /**
+             * When streaming to a sink, the buffer which the scope's results are
+             * flushed through, once the batch size is reached.
+             */
+            TestResults *spillTo = nullptr;
+
+            /**
+             * Time spent on the latest assertion, when assertions are timed.
+             */
+            Timing timing;
+        };
 
         /**
-         * Current case number (within ``it`` scope)
+         * Assertion context overriding the shared one on the current thread.
+         * See ``withOwnContext``.
          */
-        CaseNumber m_caseNo = 0;
+        struct ActiveContext {
+            const ProvidesAssertions *owner = nullptr;
+            AssertionContext *context = nullptr;
+        };
 
         /**
-         * Temporary container of test results, which will be cleared
-         * before/after starting a new round of assertions (i.e. entering an
-         * ``it`` scope).
+         * The shared assertion context, used unless the current thread
+         * has been given its own.
          */
-        TestResults m_testResults;
+        AssertionContext m_context;
+
+        static ActiveContext &activeContext() noexcept {
+            thread_local ActiveContext active;
+            return active;
+        }
 
         /**
-         * Current state of assertions.
+         * Retrieve the assertion context which applies to the current thread.
+         *
+         * @return
          */
-        AssertionState m_assertionsActive = AssertionState::NotStarted;
+        [[nodiscard]] AssertionContext &context() noexcept {
+            const ActiveContext &active = activeContext();
+            return active.owner == this ? *active.context : m_context;
+        }
+
+        [[nodiscard]] const AssertionContext &context() const noexcept {
+            const ActiveContext &active = activeContext();
+            return active.owner == this ? *active.context : m_context;
+        }
 
         /**
          * An "internal" assert method which seeks to generalize as much as
          * of the assertion process as possible, for instance by handling
          * what happens when an assertion fails, in accordance with the settings.
          *
+         * The assertion is split in two: ``check`` decides whether it passed,
+         * and ``describe`` renders the expected and actual values. The latter is
+         * only called when the assertion fails (or when ``recordPassedValues`` is
+         * enabled), so passing assertions don't pay for string formatting.
+         *
+         * Both are templated, rather than type-erased, so the compiler can inline
+         * the comparison into the assertion.
+         *
+         * @tparam Check
+         * @tparam Describe
+         * @param check
+         * @param describe
+         */
+        template<std::invocable Check, std::invocable Describe>
+        inline void assert(Check &&check, Describe &&describe) noexcept(false) {
+            AssertionContext &ctx = context();
+            if (!canAssert(ctx)) {
+                return;
+            }
+
+            bool passed = measure(ctx, check);
+            Allocations::Pause pause;
+            if (!passed || m_settings.recordPassedValues) {
+                ExpectedActual values = describe();
+                record(ctx, passed, std::move(values.expected), std::move(values.actual));
+            } else {
+                record(ctx, passed, {}, {});
+            }
+        }
+
+        /**
+         * Variant of the "internal" assert method, for assertions which produce
+         * their expected and actual values along with the outcome.
+         *
+         * @tparam F
          * @param assertionFunc
          */
-        inline void assert(const std::function<InternalResult()> &assertionFunc) noexcept(false) {
-            if (m_assertionsActive == AssertionState::Paused) {
-                m_testResults.emplace_back(Error{
-                        .errorCode = ErrorCode::PrevAssertionFailed,
-                });
-                return;
-            } else if (m_assertionsActive == AssertionState::NotStarted) {
-                std::cerr << "\nAssertions must be called within \"it\"." << std::endl;
-                return;
+        template<std::invocable F>
+        inline void assert(F &&assertionFunc) noexcept(false) {
+            AssertionContext &ctx = context();
+            if (!canAssert(ctx)) {
+                return;
+            }
+
+            InternalResult result = measure(ctx, assertionFunc);
+            Allocations::Pause pause;
+            if (result.passed && !m_settings.recordPassedValues) {
+                record(ctx, true, {}, {});
+            } else {
+                record(ctx, result.passed, std::move(result.expected), std::move(result.actual));
+            }
+        }
+
+        /**
+         * Check whether assertions can be performed in the context, and otherwise
+         * record why not.
+         *
+         * @param ctx
+         * @return
+         */
+        inline bool canAssert(AssertionContext &ctx) noexcept(false) {
+            Allocations::Pause pause;
+            if (ctx.spillTo && m_settings.sinkBatchSize && ctx.testResults.size() >= m_settings.sinkBatchSize) {
+                spill(ctx);
+            }
+
+            if (ctx.state == AssertionState::Paused) {
+                ctx.testResults.addError(ctx.caseNo, ErrorCode::PrevAssertionFailed);
+                return false;
+            } else if (ctx.state == AssertionState::NotStarted) {
+                std::cerr << "\nAssertions must be called within \"it\"." << std::endl;
+                return false;
+            } else if (m_settings.failureBudget && m_settings.failureBudget->exhausted()) {
+                throw ScopeAborted();
+            }
+            return true;
+        }
+
+        /**
+         * Hand the results of the scope (so far) to the sink, together with
+         * the results buffered before it, and continue with an empty container.
+         *
+         * @param ctx
+         */
+        void spill(AssertionContext &ctx) noexcept(false) {
+            if (m_settings.failureBudget || m_settings.resultsDatabase) {
+                size_t failures = ctx.testResults.failures();
+                m_failures += failures;
+                if (m_settings.failureBudget) {
+                    m_settings.failureBudget->fail(failures);
+                }
+            }
+
+            TestResults::Scope scope = ctx.testResults.scopes().back();
+            *ctx.spillTo += std::move(ctx.testResults);
+            m_settings.sink->push(std::move(*ctx.spillTo));
+            ctx.spillTo->clear();
+            ctx.testResults.clear();
+            ctx.testResults.beginScope(scope.description, scope.testCase);
+        }
+
+        /**
+         * Call ``func``, and measure the time spent, when assertions are timed.
+         *
+         * @tparam F
+         * @param ctx
+         * @param func
+         * @return The return value of ``func``.
+         */
+        template<std::invocable F>
+        inline auto measure(AssertionContext &ctx, F &&func) noexcept(false) {
+            if (!m_settings.timeAssertions) {
+                return func();
             }
 
-            InternalResult result = assertionFunc();
+            Utilities::Stopwatch stopwatch;
+            auto result = func();
+            ctx.timing = {stopwatch.wall(), stopwatch.cpu()};
+            return result;
+        }
 
+        /**
+         * Record the outcome of an assertion.
+         *
+         * @param ctx
+         * @param passed
+         * @param expected
+         * @param actual
+         */
+        inline void record(AssertionContext &ctx,
+                           bool passed,
+                           std::string expected,
+                           std::string actual) noexcept(false) {
             // If the test fails, and it has been requested to stop performing assertions,
             // we pause the assertions.
-            if (!result.passed && m_settings.stopAssertingAfterFail) {
-                m_assertionsActive = AssertionState::Paused;
+            if (!passed && m_settings.stopAssertingAfterFail) {
+                ctx.state = AssertionState::Paused;
             }
 
-            TestResult testResult{
-                    .info = {
-                            .caseNo = ++m_caseNo,
-                            .description = m_description,
-                    },
-                    .passed = result.passed,
-                    .expected = result.expected,
-                    .actual = result.actual,
-            };
+            ctx.testResults.addResult(++ctx.caseNo, passed, std::move(expected), std::move(actual));
+            if (m_settings.timeAssertions) {
+                ctx.testResults.setTiming(ctx.testResults.size() - 1, ctx.timing);
+            }
 
-            m_testResults.emplace_back(testResult);
+            if (!passed && m_settings.skipScopeAfterFail) {
+                throw ScopeAborted();
+            }
         }
     };
 
@@ -693,8 +2726,33 @@ namespace BBUnit {
          */
         virtual TestResults run(const Settings settings) noexcept(false) final {
             withSettings(settings);
+            failureCount() = 0;
+            m_skippedScopes = false;
+
+            Utilities::Stopwatch stopwatch;
             test();
-            return m_results;
+            bool complete = !settings.listOnly && !m_skippedScopes;
+            m_results.addCaseTiming(caseName(), {stopwatch.wall(), stopwatch.cpu()}, complete);
+            // Partial timings would mislead the balancing of shards
+            if (settings.caseDurations && complete) {
+                settings.caseDurations->set(caseName(), stopwatch.wall());
+            }
+            // A partial run may still find a failure, but mustn't pass the test case
+            if (settings.resultsDatabase && !settings.listOnly && (complete || failureCount() > 0)) {
+                settings.resultsDatabase->record(caseName(), {
+                        .failed = failureCount() > 0,
+                        .duration = stopwatch.wall(),
+                        .version = version(),
+                });
+            }
+
+            flush(true);
+
+            // Hand over the accumulated results, leaving the test case
+            // ready for another run.
+            TestResults results = std::move(m_results);
+            m_results.clear();
+            return results;
         }
 
         /**
@@ -703,6 +2761,39 @@ namespace BBUnit {
          */
         virtual void test() = 0;
 
+        /**
+         * Name of the test case, used to identify it in results and reports.
+         *
+         * By default, it's the (demangled, where possible) class name.
+         *
+         * @return
+         */
+        [[nodiscard]] virtual std::string name() const noexcept(false) {
+            std::string className = typeid(*this).name();
+#if defined(__GNUG__)
+            int status = 0;
+            char *demangled = abi::__cxa_demangle(className.c_str(), nullptr, nullptr, &status);
+            if (status == 0 && demangled) {
+                className = demangled;
+            }
+            std::free(demangled);
+#endif
+            return className;
+        }
+
+        /**
+         * Version of the test case, used by ``Settings::changedOnly`` to tell whether
+         * it has changed since it last ran. Override it, and change the returned
+         * key (for example a hash of the tested sources) when the test case changes.
+         *
+         * The key must not contain tabs or line breaks.
+         *
+         * @return
+         */
+        [[nodiscard]] virtual std::string version() const noexcept(false) {
+            return {};
+        }
+
     protected:
         /**
          * Perform operations, typically tests, while silencing the results.
@@ -722,14 +2813,267 @@ namespace BBUnit {
         /**
          * Create a group of assertions (internally referred to as "``it`` scope").
          *
+         * @tparam F
+         * @param description
+         * @param userAssertsThat
+         * @return The results of the scope, when silenced (see ``whileSilent``).
+         *      Otherwise, the results are moved into the test case's results,
+         *      and an empty container is returned.
+         */
+        template<std::invocable F>
+        TestResults it(const std::string &description, F &&userAssertsThat) noexcept(false) {
+            // Silenced scopes are inspected by the test itself, so only the
+            // reported scopes are filtered and listed
+            const Settings &settings = getSettings();
+            if ((!m_silent && !settings.itFilter.matches(description))
+                || (settings.failureBudget && settings.failureBudget->exhausted())) {
+                m_skippedScopes = true;
+                return {};
+            }
+
+            if (settings.listOnly && !m_silent) {
+                TestResults listed;
+                listed.beginScope(description, caseName());
+                return collect(std::move(listed));
+            }
+
+            // Inside ``inParallel``, the scope is only collected here, and
+            // evaluated when the declarations are complete.
+            if (m_deferring) {
+                m_deferred.push_back({description, std::function<void()>(userAssertsThat)});
+                return {};
+            }
+
+            return collect(evaluate(description, userAssertsThat, m_silent ? nullptr : &m_results));
+        }
+
+        /**
+         * Evaluate the ``it`` scopes declared within ``declarations`` concurrently.
+         *
+         * Each scope gets its own assertion context, and runs on a thread pool
+         * (the one the test case is running on, if any). The results are added
+         * in the order the scopes were declared, regardless of which finishes first.
+         *
+         * @important The scopes are evaluated after ``declarations`` has returned.
+         *      Variables declared inside ``declarations`` must therefore be
+         *      captured by value in the ``it`` scopes.
+         *
+         * @param declarations
+         * @return The results of all the scopes, when silenced (see ``whileSilent``).
+         *      Otherwise, an empty container, like ``it``.
+         */
+        TestResults inParallel(const std::function<void()> &declarations) noexcept(false) {
+            m_deferring = true;
+            try {
+                declarations();
+            } catch (...) {
+                m_deferring = false;
+                m_deferred.clear();
+                throw;
+            }
+            m_deferring = false;
+
+            std::vector<DeferredScope> scopes = std::move(m_deferred);
+            m_deferred.clear();
+
+            std::vector<TestResults> scopeResults(scopes.size());
+            auto evaluateScope = [&](size_t i) {
+                withOwnContext([&]() {
+                    scopeResults[i] = evaluate(scopes[i].description, scopes[i].func);
+                });
+            };
+
+            if (Utilities::ThreadPool *current = Utilities::ThreadPool::current()) {
+                current->forEach(scopes.size(), evaluateScope);
+            } else {
+                Utilities::ThreadPool pool(getSettings().threads);
+                pool.forEach(scopes.size(), evaluateScope);
+            }
+
+            TestResults newResults;
+            newResults.reserve(scopeResults);
+            for (TestResults &res: scopeResults) {
+                newResults += std::move(res);
+            }
+
+            return collect(std::move(newResults));
+        }
+
+        /**
+         * Create a data-driven ``it`` scope, which calls ``func`` for every row
+         * of a table (any range, such as a ``std::vector`` or a ``Utilities::CsvFile``):
+         *
+         * ````cpp
+         * itEach("Adds", std::vector<std::tuple<int, int, int>>{{1, 2, 3}, {2, 2, 4}}, [&](const auto &row) {
+         *     auto [a, b, sum] = row;
+         *     assertEquals<int>(sum, add(a, b));
+         * });
+         * ````
+         *
+         * Only failing rows are reported, with the row number and its values.
+         * The results of passing rows are discarded as soon as the row completes,
+         * and the scope ends with one assertion that all rows passed.
+         *
+         * A table given as lvalue is referenced, so it must outlive the scope
+         * (when declared in ``inParallel``). Others are moved into the scope.
+         *
+         * @tparam Rows
+         * @tparam F
+         * @param description
+         * @param rows
+         * @param func
+         * @return Like ``it``.
+         */
+        template<std::ranges::input_range Rows, typename F>
+        requires std::invocable<F &, std::ranges::range_reference_t<Rows>>
+        TestResults itEach(const std::string &description, Rows &&rows, F &&func) noexcept(false) {
+            using Table = std::remove_reference_t<Rows>;
+            using Stored = std::conditional_t<std::is_lvalue_reference_v<Rows>, std::reference_wrapper<Table>, Table>;
+
+            // Captured by value (or reference wrapper), since ``inParallel`` evaluates the scope later
+            return it(description, [this, table = Stored(std::forward<Rows>(rows)), func = std::forward<F>(func)]() mutable {
+                size_t index = 0, failed = 0;
+                for (auto &&row: static_cast<Table &>(table)) {
+                    failed += !checkRow(index++, row, func);
+                }
+                reportRows(index, failed);
+            });
+        }
+
+        /**
+         * Create a benchmark, which is a special ``it`` scope that measures the
+         * duration of calling ``func``.
+         *
+         * The measurement is recorded as a passed result, with the statistics
+         * attached. Assertions on the statistics, such as ``assertFasterThan``,
+         * are made in ``checks``.
+         *
+         * ````cpp
+         * benchmark("Sorts 1,000 integers", [&]() {
+         *     std::vector<int> copy = input;
+         *     std::sort(copy.begin(), copy.end());
+         *     doNotOptimize(copy);
+         * }, [&](const BenchmarkStats &stats) {
+         *     assertFasterThan(stats, std::chrono::microseconds(100));
+         * });
+         * ````
+         *
+         * @tparam F
+         * @tparam Checks
+         * @param description
+         * @param func
+         * @param checks
+         * @param options
+         * @return Like ``it``.
+         */
+        template<std::invocable F, std::invocable<const BenchmarkStats &> Checks>
+        TestResults benchmark(const std::string &description,
+                              F &&func,
+                              Checks &&checks,
+                              const std::optional<BenchmarkOptions> &options = std::nullopt) noexcept(false) {
+            // Captured by value, since ``inParallel`` evaluates the scope later
+            return it(description, [this, description, options, func = std::forward<F>(func), checks = std::forward<Checks>(checks)]() mutable {
+                BenchmarkStats stats = Benchmark::measure(func, options.value_or(getSettings().benchmarkOptions));
+                stats.description = description;
+                reportBenchmark(stats);
+                checks(stats);
+            });
+        }
+
+        /**
+         * Create a benchmark without assertions, which only records the measurement.
+         *
+         * @tparam F
+         * @param description
+         * @param func
+         * @param options
+         * @return Like ``it``.
+         */
+        template<std::invocable F>
+        TestResults benchmark(const std::string &description,
+                              F &&func,
+                              const std::optional<BenchmarkOptions> &options = std::nullopt) noexcept(false) {
+            return benchmark(description, std::forward<F>(func), [](const BenchmarkStats &) {}, options);
+        }
+
+    private:
+        /**
+         * Move the results of a scope into the test case's results, unless silenced.
+         *
+         * @param newResults
+         * @return Like ``it``.
+         */
+        TestResults collect(TestResults &&newResults) noexcept(false) {
+            if (!m_silent) {
+                if (getSettings().resultsDatabase) {
+                    failureCount() += newResults.failures();
+                }
+                m_results += std::move(newResults);
+                flush(false);
+                return {};
+            }
+
+            return std::move(newResults);
+        }
+
+        /**
+         * When streaming to a sink, hand over the buffered results once
+         * there are enough of them (or at any rate, when ``force`` is true).
+         *
+         * @param force
+         */
+        void flush(bool force) noexcept(false) {
+            const Settings &settings = getSettings();
+            if (!settings.sink || (m_results.empty() && m_results.scopes().empty() && m_results.caseTimings().empty())) {
+                return;
+            }
+            if (force || m_results.size() >= settings.sinkBatchSize) {
+                settings.sink->push(std::move(m_results));
+                m_results.clear();
+            }
+        }
+
+        /**
+         * The name of the test case, which is only determined once.
+         *
+         * @return
+         */
+        const std::string &caseName() noexcept(false) {
+            std::call_once(*m_nameOnce, [this]() {
+                m_name = name();
+            });
+            return m_name;
+        }
+
+        /**
+         * An ``it`` scope waiting to be evaluated by ``inParallel``.
+         */
+        struct DeferredScope {
+            std::string description;
+            std::function<void()> func;
+        };
+
+        /**
+         * Evaluate an ``it`` scope in the current assertion context.
+         *
+         * @tparam F
          * @param description
          * @param userAssertsThat
+         * @param spillTo See ``start``.
          * @return
          */
-        TestResults it(const std::string &description,
-                       const std::function<void()> &userAssertsThat) noexcept(false) {
-            start(description);
+        template<std::invocable F>
+        TestResults evaluate(const std::string &description,
+                             F &&userAssertsThat,
+                             TestResults *spillTo = nullptr) noexcept(false) {
+            Utilities::Stopwatch stopwatch;
+            start(description, caseName(), spillTo);
             TestResults newResults;
+            std::optional<Utilities::CounterValues> countersStart;
+            if (getSettings().countHardwareEvents) {
+                countersStart = Utilities::PerfCounters::read();
+            }
+            Allocations::Tracker allocations;
 
             // We encapsulate the function in a try/catch block to catch unintended
             // errors. If we didn't do this, a "simple" error like ``std::bad_optional_access``
@@ -737,23 +3081,34 @@ namespace BBUnit {
             // show it in the result sheet that this error occurred.
             try {
                 userAssertsThat();
-                newResults = getResults();
+                allocations.finish();
+                newResults = takeResults();
+            } catch (const ScopeAborted &) {
+                allocations.finish();
+                newResults = takeResults();
             } catch (const std::exception &e) {
+                allocations.finish();
                 newResults.emplace_back(generateExceptionError(e.what(), description));
             } catch (...) {
+                allocations.finish();
                 newResults.emplace_back(generateExceptionError("Unknown exception.", description));
             }
 
-            if (!m_silent) {
-                m_results.insert(m_results.end(), newResults.begin(), newResults.end());
+            Utilities::CounterValues counters;
+            if (countersStart) {
+                counters = Utilities::PerfCounters::read().since(*countersStart);
             }
-
             end();
 
+            newResults.finishScope(caseName(), {stopwatch.wall(), stopwatch.cpu()}, allocations.finish(), counters);
+            // Silenced results are inspected by the test itself, and don't count
+            if (getSettings().failureBudget && !m_silent) {
+                getSettings().failureBudget->fail(newResults.failures());
+            }
+
             return newResults;
         }
 
-    private:
         /**
          * Helper function to generate the Error object when
          * information about an exception has been provided.
@@ -780,6 +3135,29 @@ namespace BBUnit {
          */
         bool m_silent = false;
 
+        /**
+         * Whether an ``it`` scope was left out in the current run, by the filter
+         * or by an exhausted failure budget.
+         */
+        bool m_skippedScopes = false;
+
+        /**
+         * Cached result of ``name``. The flag is shared by copies, which is
+         * harmless, since copies share the type too.
+         */
+        std::string m_name;
+        std::shared_ptr<std::once_flag> m_nameOnce = std::make_shared<std::once_flag>();
+
+        /**
+         * True while collecting the ``it`` scopes of an ``inParallel`` block.
+         */
+        bool m_deferring = false;
+
+        /**
+         * The ``it`` scopes collected by ``inParallel``.
+         */
+        std::vector<DeferredScope> m_deferred;
+
         /**
          * Accumulated test results across all ``it`` scopes.
          */
@@ -791,15 +3169,302 @@ namespace BBUnit {
      */
     class TestRunner {
     public:
-        static TestResults run(const std::vector<std::shared_ptr<TestCase>> &testCases) noexcept(false) {
+        /**
+         * Run the test cases, and collect their results in the order
+         * the test cases were provided.
+         *
+         * When a ``sink`` is provided in the settings, the results are streamed
+         * to it instead, and the returned container is empty.
+         *
+         * @param testCases
+         * @param settings
+         * @return
+         */
+        static TestResults run(const std::vector<std::shared_ptr<TestCase>> &testCases,
+                               const Settings &settings = {}) noexcept(false) {
+            if (!settings.caseFilter.empty()) {
+                std::vector<std::shared_ptr<TestCase>> selected;
+                std::copy_if(testCases.begin(), testCases.end(), std::back_inserter(selected),
+                             [&](const std::shared_ptr<TestCase> &testCase) {
+                                 return settings.caseFilter.matches(testCase->name());
+                             });
+                Settings unfiltered = settings;
+                unfiltered.caseFilter = {};
+                return run(selected, unfiltered);
+            }
+
+            if (settings.maxFailures && !settings.failureBudget) {
+                Settings budgeted = settings;
+                budgeted.failureBudget = std::make_shared<Utilities::FailureBudget>(settings.maxFailures);
+                return run(testCases, budgeted);
+            }
+
+            if (settings.resultsDatabase && (settings.rerunFailed || settings.changedOnly)) {
+                Settings unselected = settings;
+                unselected.rerunFailed = unselected.changedOnly = false;
+                return run(selectIncremental(testCases, settings), unselected);
+            }
+
+            // An index without a count is rejected by ``shard``, rather than ignored
+            if (settings.shardCount > 1 || settings.shardIndex > 0) {
+                Settings unsharded = settings;
+                unsharded.shardCount = 1;
+                unsharded.shardIndex = 0;
+                return run(shard(testCases, settings), unsharded);
+            }
+
+            TestResults result = runAll(testCases, settings);
+
+            if (settings.caseDurations) {
+                settings.caseDurations->save();
+            }
+            if (settings.resultsDatabase) {
+                settings.resultsDatabase->save();
+            }
+
+            return result;
+        }
+
+        /**
+         * Select the test cases which failed, or have changed, since they last
+         * ran, according to ``settings.rerunFailed`` and ``settings.changedOnly``.
+         *
+         * @param testCases
+         * @param settings
+         * @return
+         */
+        [[nodiscard]] static std::vector<std::shared_ptr<TestCase>> selectIncremental(const std::vector<std::shared_ptr<TestCase>> &testCases,
+                                                                                      const Settings &settings) noexcept(false) {
+            std::vector<std::shared_ptr<TestCase>> selected;
+            for (const std::shared_ptr<TestCase> &testCase: testCases) {
+                auto entry = settings.resultsDatabase->find(testCase->name());
+                if ((settings.rerunFailed && entry && entry->failed)
+                    || (settings.changedOnly && (!entry || entry->version != testCase->version()))) {
+                    selected.push_back(testCase);
+                }
+            }
+            return selected;
+        }
+
+        /**
+         * Select the test cases belonging to shard ``settings.shardIndex``,
+         * keeping their order.
+         *
+         * @throws std::invalid_argument When the index is out of range.
+         * @param testCases
+         * @param settings
+         * @return
+         */
+        [[nodiscard]] static std::vector<std::shared_ptr<TestCase>> shard(const std::vector<std::shared_ptr<TestCase>> &testCases,
+                                                                          const Settings &settings) noexcept(false) {
+            if (settings.shardIndex >= std::max(settings.shardCount, 1u)) {
+                throw std::invalid_argument("Shard index " + std::to_string(settings.shardIndex)
+                                            + " is out of range for " + std::to_string(settings.shardCount) + " shards");
+            }
+
+            std::vector<std::optional<std::chrono::nanoseconds>> durations;
+            durations.reserve(testCases.size());
+            for (const std::shared_ptr<TestCase> &testCase: testCases) {
+                durations.push_back(settings.caseDurations ? settings.caseDurations->find(testCase->name()) : std::nullopt);
+            }
+
+            std::vector<unsigned int> assigned = Utilities::Sharding::assign(durations, settings.shardCount);
+            std::vector<std::shared_ptr<TestCase>> selected;
+            for (size_t i = 0; i < testCases.size(); ++i) {
+                if (assigned[i] == settings.shardIndex) {
+                    selected.push_back(testCases[i]);
+                }
+            }
+            return selected;
+        }
+
+    private:
+        /**
+         * Run the test cases in this process (in order, or in parallel),
+         * or in worker processes.
+         *
+         * @param testCases
+         * @param settings
+         * @return
+         */
+        static TestResults runAll(const std::vector<std::shared_ptr<TestCase>> &testCases,
+                                  const Settings &settings) noexcept(false) {
+#ifdef BBUNIT_HAS_PROCESS_POOL
+            if (settings.isolated) {
+                return runIsolated(testCases, settings);
+            }
+#endif
+
+            if (!settings.parallel) {
+                TestResults result;
+                std::for_each(testCases.begin(),
+                              testCases.end(),
+                              [&](const std::shared_ptr<TestCase> &testCase) {
+                                  if (!cancelled(settings)) {
+                                      result += testCase->run(settings);
+                                  }
+                              });
+
+                if (settings.sink) {
+                    settings.sink->finish();
+                }
+
+                return result;
+            }
+
+            // Each test case owns its results and assertion state, so they can
+            // run independently. We collect per-case results, and merge them
+            // afterward, to keep the output deterministic.
+            std::vector<TestResults> caseResults(testCases.size());
+            Utilities::ThreadPool pool(settings.threads);
+            pool.forEach(testCases.size(), [&](size_t i) {
+                if (!cancelled(settings)) {
+                    caseResults[i] = testCases[i]->run(settings);
+                }
+            });
+
+            TestResults result;
+            result.reserve(caseResults);
+            for (TestResults &res: caseResults) {
+                result += std::move(res);
+            }
+
+            if (settings.sink) {
+                settings.sink->finish();
+            }
+
+            return result;
+        }
+
+        /**
+         * Whether the run has been cut short, see ``Settings::maxFailures``.
+         *
+         * @param settings
+         * @return
+         */
+        [[nodiscard]] static bool cancelled(const Settings &settings) noexcept {
+            return settings.failureBudget && settings.failureBudget->exhausted();
+        }
+
+#ifdef BBUNIT_HAS_PROCESS_POOL
+        /**
+         * Sink used in worker processes, which sends the results to the runner.
+         */
+        class ForwardingSink : public ResultSink {
+        public:
+            explicit ForwardingSink(const Utilities::ProcessPool::Send &send) : m_send(send) {}
+
+        protected:
+            void consume(TestResults &&results) override {
+                m_buffer.clear();
+                results.serialize(m_buffer);
+                m_send(m_buffer);
+            }
+
+        private:
+            const Utilities::ProcessPool::Send &m_send;
+
+            std::string m_buffer;
+        };
+
+        /**
+         * Run the test cases in worker processes. Results are streamed back
+         * while the test cases run, so the results of a crashed test case are
+         * kept up until the ``it`` scope it crashed in.
+         *
+         * @param testCases
+         * @param settings
+         * @return
+         */
+        static TestResults runIsolated(const std::vector<std::shared_ptr<TestCase>> &testCases,
+                                       const Settings &settings) noexcept(false) {
+            std::vector<TestResults> caseResults(settings.sink ? 0 : testCases.size());
+
+            // The workers' copies of the settings are discarded, so failures and
+            // durations are counted here, from the results they send
+            std::vector<size_t> failures(testCases.size(), 0);
+            std::vector<std::chrono::nanoseconds> durations(testCases.size(), std::chrono::nanoseconds(0));
+            std::vector<bool> complete(testCases.size(), false);
+
+            Utilities::ProcessPool pool(settings.threads, settings.timeout);
+            pool.run(testCases.size(), [&](size_t i, const Utilities::ProcessPool::Send &send) {
+                Settings workerSettings = settings;
+                workerSettings.isolated = false;
+                workerSettings.sink = std::make_shared<ForwardingSink>(send);
+                try {
+                    testCases[i]->run(workerSettings);
+                } catch (const std::exception &e) {
+                    TestResults error;
+                    error.beginScope(testCases[i]->name(), testCases[i]->name());
+                    error.addError(0, ErrorCode::ExceptionCaught, e.what());
+                    error.finishScope(testCases[i]->name(), {});
+                    workerSettings.sink->push(std::move(error));
+                }
+            }, [&](size_t i, std::string &&message) {
+                TestResults results = TestResults::deserialize(message);
+                size_t failed = results.failures();
+                failures[i] += failed;
+                if (settings.failureBudget && settings.failureBudget->fail(failed)) {
+                    pool.cancel();
+                }
+                for (const TestResults::CaseTiming &caseTiming: results.caseTimings()) {
+                    durations[i] = caseTiming.timing.wall;
+                    complete[i] = caseTiming.complete;
+                    if (settings.caseDurations && caseTiming.complete) {
+                        settings.caseDurations->set(caseTiming.testCase, caseTiming.timing.wall);
+                    }
+                }
+                if (settings.sink) {
+                    settings.sink->push(std::move(results));
+                } else {
+                    caseResults[i] += std::move(results);
+                }
+            }, [&](size_t i, const Utilities::ProcessPool::Outcome &outcome) {
+                if (outcome.status == Utilities::ProcessPool::Status::Cancelled) {
+                    return;
+                }
+
+                bool completed = outcome.status == Utilities::ProcessPool::Status::Completed;
+                bool failed = !completed || failures[i] > 0;
+                if (settings.resultsDatabase && !settings.listOnly && (complete[i] || failed)) {
+                    settings.resultsDatabase->record(testCases[i]->name(), {
+                            .failed = failed,
+                            .duration = completed ? durations[i] : outcome.elapsed,
+                            .version = testCases[i]->version(),
+                    });
+                }
+                if (completed) {
+                    return;
+                }
+                if (settings.failureBudget && settings.failureBudget->fail()) {
+                    pool.cancel();
+                }
+
+                TestResults error;
+                error.beginScope(testCases[i]->name(), testCases[i]->name());
+                error.addError(0,
+                               outcome.status == Utilities::ProcessPool::Status::TimedOut ? ErrorCode::TimedOut : ErrorCode::Crashed,
+                               outcome.reason);
+                error.finishScope(testCases[i]->name(), {});
+                if (settings.sink) {
+                    settings.sink->push(std::move(error));
+                } else {
+                    caseResults[i] += std::move(error);
+                }
+            });
+
             TestResults result;
-            std::for_each(testCases.begin(),
-                          testCases.end(),
-                          [&](const std::shared_ptr<TestCase> &testCase) {
-                              result += testCase->run();
-                          });
+            result.reserve(caseResults);
+            for (TestResults &res: caseResults) {
+                result += std::move(res);
+            }
+
+            if (settings.sink) {
+                settings.sink->finish();
+            }
 
             return result;
         }
+#endif
     };
 }
@@ -0,0 +1,383 @@
+/**
+ * C++ BBUnit - Benchmarking
+ *
+ * Measurement and statistics behind ``TestCase::benchmark``, along with
+ * helpers which prevent the optimizer from removing the benchmarked code.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "utilities/perf-counters.hpp"
+
+namespace BBUnit {
+    namespace Internal {
+        /**
+         * Pointer the optimizer must assume is read elsewhere.
+         */
+        inline volatile const void *escapedPointer = nullptr;
+    }
+
+    /**
+     * Prevent the optimizer from discarding ``value`` (or the computation
+     * which produced it) as unused.
+     *
+     * @tparam T
+     * @param value
+     */
+    template<typename T>
+    inline void doNotOptimize(const T &value) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : "r,m"(value) : "memory");
+#else
+        Internal::escapedPointer = &value;
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+    }
+
+    /**
+     * Prevent the optimizer from discarding ``value``, or assuming it's
+     * unchanged after this point.
+     *
+     * @tparam T
+     * @param value
+     */
+    template<typename T>
+    inline void doNotOptimize(T &value) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : "+m"(value) : : "memory");
+#else
+        Internal::escapedPointer = &value;
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+    }
+
+    /**
+     * Force all pending writes to memory to be considered done, so
+     * the optimizer can't elide or reorder them across this point.
+     */
+    inline void clobberMemory() noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : : "memory");
+#else
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+    }
+
+    /**
+     * Duration in fractional nanoseconds, so calls faster than a nanosecond
+     * aren't rounded to zero.
+     */
+    using BenchmarkDuration = std::chrono::duration<double, std::nano>;
+
+    /**
+     * Options for how a benchmark is measured.
+     */
+    struct BenchmarkOptions {
+        /**
+         * How long the code is run before measuring starts, to warm up
+         * caches, branch predictors, etc. It's also used to estimate how
+         * many iterations fit in a sample.
+         */
+        std::chrono::nanoseconds warmUpTime = std::chrono::milliseconds(20);
+
+        /**
+         * Approximate total time spent measuring.
+         */
+        std::chrono::nanoseconds measureTime = std::chrono::milliseconds(200);
+
+        /**
+         * Number of samples the statistics are computed from.
+         */
+        size_t samples = 30;
+    };
+
+    /**
+     * Statistics of a benchmark. All durations are per call of the
+     * benchmarked code.
+     */
+    struct BenchmarkStats {
+        /**
+         * Description of the benchmark, used as key in the baseline.
+         */
+        std::string description;
+
+        /**
+         * Number of samples, and the number of calls timed in each.
+         */
+        size_t samples = 0, iterations = 0;
+
+        BenchmarkDuration median{0}, p95{0}, mean{0}, min{0}, max{0};
+
+        /**
+         * Standard deviation in nanoseconds.
+         */
+        double stddev = 0;
+
+        /**
+         * Hardware events of all the timed calls together, when the counters
+         * are available (see ``Utilities::PerfCounters``).
+         */
+        Utilities::CounterValues counters;
+
+        /**
+         * Average of a counter per call, such as ``perCall(stats.counters.instructions)``.
+         *
+         * @param total
+         * @return
+         */
+        [[nodiscard]] double perCall(uint64_t total) const noexcept {
+            size_t calls = samples * iterations;
+            return calls == 0 ? 0 : static_cast<double>(total) / static_cast<double>(calls);
+        }
+
+        /**
+         * Compute the statistics from per-call durations, in nanoseconds.
+         *
+         * @param samples
+         * @return
+         */
+        [[nodiscard]] static BenchmarkStats fromSamples(std::vector<double> samples) noexcept(false) {
+            BenchmarkStats stats;
+            stats.samples = samples.size();
+            if (samples.empty()) {
+                return stats;
+            }
+
+            std::sort(samples.begin(), samples.end());
+
+            size_t n = samples.size();
+            double median = n % 2 ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+
+            // Nearest-rank percentile
+            size_t p95Rank = static_cast<size_t>(std::ceil(0.95 * static_cast<double>(n)));
+            double p95 = samples[std::max<size_t>(p95Rank, 1) - 1];
+
+            double sum = 0;
+            for (double sample: samples) {
+                sum += sample;
+            }
+            double mean = sum / static_cast<double>(n);
+
+            double squares = 0;
+            for (double sample: samples) {
+                squares += (sample - mean) * (sample - mean);
+            }
+
+            stats.median = BenchmarkDuration(median);
+            stats.p95 = BenchmarkDuration(p95);
+            stats.mean = BenchmarkDuration(mean);
+            stats.min = BenchmarkDuration(samples.front());
+            stats.max = BenchmarkDuration(samples.back());
+            stats.stddev = n > 1 ? std::sqrt(squares / static_cast<double>(n - 1)) : 0;
+
+            return stats;
+        }
+
+        /**
+         * Human-readable summary, such as "median 1.20 us, p95 1.45 us, stddev 0.10 us".
+         * When hardware events were counted, the averages per call follow, such as
+         * "3600 cycles, 9100 instructions, 2 cache misses, 14 branch misses per call".
+         *
+         * @return
+         */
+        [[nodiscard]] std::string summary() const noexcept(false) {
+            std::string text = "median " + formatDuration(median.count())
+                               + ", p95 " + formatDuration(p95.count())
+                               + ", stddev " + formatDuration(stddev)
+                               + " (" + std::to_string(samples) + " x " + std::to_string(iterations) + " calls)";
+            if (counters.measured == 0) {
+                return text;
+            }
+
+            std::string events;
+            auto add = [&](uint32_t event, uint64_t total, const char *name) {
+                if (counters.has(event)) {
+                    events += (events.empty() ? "" : ", ") + std::to_string(std::llround(perCall(total))) + " " + name;
+                }
+            };
+            add(Utilities::PerfCounters::Cycles, counters.cycles, "cycles");
+            add(Utilities::PerfCounters::Instructions, counters.instructions, "instructions");
+            add(Utilities::PerfCounters::CacheMisses, counters.cacheMisses, "cache misses");
+            add(Utilities::PerfCounters::BranchMisses, counters.branchMisses, "branch misses");
+            return text + "; " + events + " per call";
+        }
+
+        /**
+         * Format a duration given in nanoseconds with a suitable unit.
+         *
+         * @param ns
+         * @return
+         */
+        [[nodiscard]] static std::string formatDuration(double ns) noexcept(false) {
+            char buffer[32];
+            if (ns < 1e3) {
+                std::snprintf(buffer, sizeof(buffer), "%.0f ns", ns);
+            } else if (ns < 1e6) {
+                std::snprintf(buffer, sizeof(buffer), "%.2f us", ns / 1e3);
+            } else if (ns < 1e9) {
+                std::snprintf(buffer, sizeof(buffer), "%.2f ms", ns / 1e6);
+            } else {
+                std::snprintf(buffer, sizeof(buffer), "%.2f s", ns / 1e9);
+            }
+            return buffer;
+        }
+    };
+
+    /**
+     * Measure the duration of calling a function.
+     */
+    class Benchmark {
+    public:
+        /**
+         * Warm up, pick a number of iterations per sample which makes the
+         * measurement take roughly ``options.measureTime``, and time the samples.
+         * Hardware events are counted across the samples, when the counters are
+         * available.
+         *
+         * @tparam F
+         * @param func
+         * @param options
+         * @return
+         */
+        template<typename F>
+        [[nodiscard]] static BenchmarkStats measure(F &&func, const BenchmarkOptions &options = {}) noexcept(false) {
+            using Clock = std::chrono::steady_clock;
+
+            // Warm-up, which doubles as an estimate of the duration of one call
+            size_t warmUpCalls = 0;
+            auto warmUpStart = Clock::now();
+            auto elapsed = Clock::duration::zero();
+            do {
+                func();
+                clobberMemory();
+                ++warmUpCalls;
+                elapsed = Clock::now() - warmUpStart;
+            } while (elapsed < options.warmUpTime);
+
+            double perCall = std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(warmUpCalls);
+            size_t samples = std::max<size_t>(options.samples, 1);
+            double perSample = std::chrono::duration<double, std::nano>(options.measureTime).count() / static_cast<double>(samples);
+            size_t iterations = std::max<size_t>(1, static_cast<size_t>(perSample / std::max(perCall, 1.0)));
+
+            std::vector<double> durations;
+            durations.reserve(samples);
+            Utilities::CounterValues countersStart = Utilities::PerfCounters::read();
+            for (size_t s = 0; s < samples; ++s) {
+                auto start = Clock::now();
+                for (size_t i = 0; i < iterations; ++i) {
+                    func();
+                    clobberMemory();
+                }
+                auto sample = Clock::now() - start;
+                durations.push_back(std::chrono::duration<double, std::nano>(sample).count() / static_cast<double>(iterations));
+            }
+
+            Utilities::CounterValues counters = Utilities::PerfCounters::read().since(countersStart);
+
+            BenchmarkStats stats = BenchmarkStats::fromSamples(std::move(durations));
+            stats.iterations = iterations;
+            stats.counters = counters;
+            return stats;
+        }
+    };
+
+    /**
+     * Median durations from a previous run, used by ``assertNoSlowerThanBaseline``.
+     *
+     * The file consists of lines on the form ``<median in ns><tab><description>``.
+     * Benchmarks which aren't in the baseline yet are added when measured, so
+     * calling ``save`` after a run creates (or extends) the baseline.
+     */
+    class BenchmarkBaseline {
+    public:
+        BenchmarkBaseline() = default;
+
+        /**
+         * Load the baseline from a file. A missing file is treated as an
+         * empty baseline, and malformed lines are skipped.
+         *
+         * @param path
+         */
+        explicit BenchmarkBaseline(std::string path) : m_path(std::move(path)) {
+            std::ifstream file(m_path);
+            std::string line;
+            while (std::getline(file, line)) {
+                size_t tab = line.find('\t');
+                if (tab == std::string::npos) {
+                    continue;
+                }
+                double median = 0;
+                auto [end, error] = std::from_chars(line.data(), line.data() + tab, median);
+                if (error != std::errc() || end != line.data() + tab) {
+                    continue;
+                }
+                m_medians[line.substr(tab + 1)] = BenchmarkDuration(median);
+            }
+        }
+
+        /**
+         * Look up the baseline median of a benchmark.
+         *
+         * @param description
+         * @return
+         */
+        [[nodiscard]] std::optional<BenchmarkDuration> find(const std::string &description) const noexcept(false) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto found = m_medians.find(description);
+            if (found == m_medians.end()) {
+                return std::nullopt;
+            }
+            return found->second;
+        }
+
+        /**
+         * Set the baseline median of a benchmark.
+         *
+         * @param description
+         * @param median
+         */
+        void set(const std::string &description, BenchmarkDuration median) noexcept(false) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_medians[description] = median;
+        }
+
+        /**
+         * Write the baseline to the file it was loaded from.
+         * Nothing happens, when there's no file.
+         */
+        void save() const noexcept(false) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_path.empty()) {
+                return;
+            }
+            std::ofstream file(m_path);
+            for (const auto &[description, median]: m_medians) {
+                // Shortest representation which reads back as the same value
+                char digits[32];
+                auto result = std::to_chars(digits, digits + sizeof(digits), median.count());
+                file.write(digits, result.ptr - digits) << '\t' << description << '\n';
+            }
+        }
+
+    private:
+        std::string m_path;
+
+        mutable std::mutex m_mutex;
+
+        std::map<std::string, BenchmarkDuration> m_medians;
+    };
+}
@@ -0,0 +1,353 @@
+/**
+ * C++ BBUnit - Diffs
+ *
+ * Comparison of containers and byte buffers, which on a mismatch describes
+ * a bounded number of differences, behind ``assertContainerEquals`` and
+ * ``assertBytesEqual``.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "formatter.hpp"
+
+namespace BBUnit {
+    /**
+     * How much of a difference to describe.
+     */
+    struct DiffOptions {
+        /**
+         * Largest number of differing elements (or keys) to describe.
+         * The rest are only counted.
+         */
+        size_t maxDifferences = 8;
+
+        /**
+         * Number of bytes to show on each side of the first differing byte
+         * of a byte buffer.
+         */
+        size_t context = 8;
+    };
+
+    /**
+     * Outcome of comparing two containers.
+     */
+    struct ContainerDiff {
+        size_t expectedSize = 0;
+        size_t actualSize = 0;
+
+        /**
+         * Number of differing elements (or keys), including missing and unexpected ones.
+         */
+        size_t differences = 0;
+
+        /**
+         * Descriptions of the first ``DiffOptions::maxDifferences`` differences,
+         * such as ``[3] 7 (expected 4)``.
+         */
+        std::vector<std::string> described;
+
+        [[nodiscard]] bool equal() const noexcept {
+            return differences == 0;
+        }
+    };
+
+    /**
+     * Outcome of comparing two byte buffers.
+     */
+    struct ByteDiff {
+        size_t expectedSize = 0;
+        size_t actualSize = 0;
+
+        /**
+         * Number of differing bytes, counting the bytes one buffer is longer as differing.
+         */
+        size_t differences = 0;
+
+        /**
+         * Offset of the first differing byte.
+         */
+        size_t firstDifference = 0;
+
+        [[nodiscard]] bool equal() const noexcept {
+            return differences == 0;
+        }
+    };
+
+    /**
+     * Concept for map-like containers, such as ``std::map`` and ``std::unordered_map``.
+     *
+     * @tparam T
+     */
+    template<typename T>
+    concept MapLike = std::ranges::forward_range<T> && requires(const T &map, const typename T::key_type &key) {
+        typename T::mapped_type;
+        { map.find(key) } -> std::same_as<typename T::const_iterator>;
+    };
+
+    /**
+     * Comparison of containers and byte buffers.
+     */
+    class Diff {
+    public:
+        /**
+         * Compare two sequences, such as a ``std::vector`` and a ``std::array``, element by element.
+         *
+         * Contiguous sequences of the same trivially-copyable type are first compared
+         * with ``memcmp``, and only walked element by element when they differ.
+         *
+         * @tparam E
+         * @tparam A
+         * @param expected
+         * @param actual
+         * @param options
+         * @return
+         */
+        template<std::ranges::forward_range E, std::ranges::forward_range A>
+        [[nodiscard]] static ContainerDiff sequences(const E &expected,
+                                                     const A &actual,
+                                                     const DiffOptions &options) noexcept(false) {
+            ContainerDiff diff;
+            diff.expectedSize = static_cast<size_t>(std::ranges::distance(expected));
+            diff.actualSize = static_cast<size_t>(std::ranges::distance(actual));
+
+            using T = std::ranges::range_value_t<E>;
+            if constexpr (std::ranges::contiguous_range<E> && std::ranges::contiguous_range<A>
+                          && std::is_same_v<T, std::ranges::range_value_t<A>>
+                          && std::has_unique_object_representations_v<T>) {
+                if (diff.expectedSize == diff.actualSize
+                    && (diff.expectedSize == 0 || std::memcmp(std::ranges::data(expected),
+                                                              std::ranges::data(actual),
+                                                              diff.expectedSize * sizeof(T)) == 0)) {
+                    return diff;
+                }
+            }
+
+            auto e = std::ranges::begin(expected);
+            auto a = std::ranges::begin(actual);
+            size_t index = 0;
+            for (; e != std::ranges::end(expected) && a != std::ranges::end(actual); ++e, ++a, ++index) {
+                if (!(*e == *a)) {
+                    record(diff, options, [&](std::string &text) {
+                        differs(text, at(index), *a, *e);
+                    });
+                }
+            }
+            for (; e != std::ranges::end(expected); ++e, ++index) {
+                record(diff, options, [&](std::string &text) {
+                    missing(text, at(index), *e);
+                });
+            }
+            for (; a != std::ranges::end(actual); ++a, ++index) {
+                record(diff, options, [&](std::string &text) {
+                    unexpected(text, at(index), *a);
+                });
+            }
+            return diff;
+        }
+
+        /**
+         * Compare two maps by key.
+         *
+         * Ordered maps of the same type are walked side by side, in a single pass.
+         * Otherwise, the keys of each map are looked up in the other.
+         *
+         * @tparam M
+         * @param expected
+         * @param actual
+         * @param options
+         * @return
+         */
+        template<MapLike M>
+        [[nodiscard]] static ContainerDiff maps(const M &expected,
+                                                const M &actual,
+                                                const DiffOptions &options) noexcept(false) {
+            ContainerDiff diff;
+            diff.expectedSize = expected.size();
+            diff.actualSize = actual.size();
+
+            auto different = [&](const auto &e, const auto &a) {
+                record(diff, options, [&](std::string &text) {
+                    differs(text, key(e.first), a.second, e.second);
+                });
+            };
+            auto absent = [&](const auto &e) {
+                record(diff, options, [&](std::string &text) {
+                    missing(text, key(e.first), e.second);
+                });
+            };
+            auto extra = [&](const auto &a) {
+                record(diff, options, [&](std::string &text) {
+                    unexpected(text, key(a.first), a.second);
+                });
+            };
+
+            if constexpr (requires { expected.key_comp(); }) {
+                auto less = expected.key_comp();
+                auto e = expected.begin(), a = actual.begin();
+                while (e != expected.end() || a != actual.end()) {
+                    if (a == actual.end() || (e != expected.end() && less(e->first, a->first))) {
+                        absent(*e++);
+                    } else if (e == expected.end() || less(a->first, e->first)) {
+                        extra(*a++);
+                    } else {
+                        if (!(e->second == a->second)) {
+                            different(*e, *a);
+                        }
+                        ++e, ++a;
+                    }
+                }
+            } else {
+                for (const auto &e: expected) {
+                    auto a = actual.find(e.first);
+                    if (a == actual.end()) {
+                        absent(e);
+                    } else if (!(e.second == a->second)) {
+                        different(e, *a);
+                    }
+                }
+                for (const auto &a: actual) {
+                    if (expected.find(a.first) == expected.end()) {
+                        extra(a);
+                    }
+                }
+            }
+            return diff;
+        }
+
+        /**
+         * Compare two byte buffers with ``memcmp``, and only count the differing
+         * bytes when they aren't equal.
+         *
+         * @param expected
+         * @param actual
+         * @return
+         */
+        [[nodiscard]] static ByteDiff bytes(std::span<const std::byte> expected,
+                                            std::span<const std::byte> actual) noexcept {
+            ByteDiff diff{.expectedSize = expected.size(), .actualSize = actual.size()};
+            size_t common = std::min(expected.size(), actual.size());
+            if (common > 0 && std::memcmp(expected.data(), actual.data(), common) == 0) {
+                common = 0;
+                diff.firstDifference = std::min(expected.size(), actual.size());
+            } else {
+                diff.firstDifference = static_cast<size_t>(
+                        std::mismatch(expected.begin(), expected.begin() + static_cast<std::ptrdiff_t>(common),
+                                      actual.begin()).first - expected.begin());
+            }
+            for (size_t i = diff.firstDifference; i < common; ++i) {
+                diff.differences += expected[i] != actual[i];
+            }
+            diff.differences += std::max(expected.size(), actual.size()) - std::min(expected.size(), actual.size());
+            return diff;
+        }
+
+        /**
+         * Hexadecimal dump of the bytes around ``offset``, such as ``0x0ff8: 41 42 [00] 44``,
+         * where the bytes which differ from ``other`` are in brackets.
+         *
+         * @param bytes
+         * @param other
+         * @param offset
+         * @param context Number of bytes to show on each side of ``offset``.
+         * @return
+         */
+        [[nodiscard]] static std::string hexdump(std::span<const std::byte> bytes,
+                                                 std::span<const std::byte> other,
+                                                 size_t offset,
+                                                 size_t context) noexcept(false) {
+            static constexpr char hex[] = "0123456789abcdef";
+            size_t from = offset > context ? offset - context : 0;
+            size_t to = std::min(bytes.size(), offset + context + 1);
+
+            std::string text = address(from) + ":";
+            if (from >= to) {
+                return text + " <End>";
+            }
+            text.reserve(text.size() + (to - from) * 5);
+            for (size_t i = from; i < to; ++i) {
+                auto value = static_cast<unsigned char>(bytes[i]);
+                bool differs = i >= other.size() || bytes[i] != other[i];
+                text += differs ? " [" : " ";
+                text += hex[value >> 4];
+                text += hex[value & 0xf];
+                if (differs) {
+                    text += ']';
+                }
+            }
+            return text;
+        }
+
+        /**
+         * An offset rendered as hexadecimal, such as ``0x0ff8``.
+         *
+         * @param offset
+         * @return
+         */
+        [[nodiscard]] static std::string address(size_t offset) noexcept(false) {
+            char digits[24];
+            auto result = std::to_chars(digits, digits + sizeof(digits), offset, 16);
+            std::string text(digits, result.ptr);
+            return "0x" + std::string(text.size() < 4 ? 4 - text.size() : 0, '0') + text;
+        }
+
+    private:
+        /**
+         * Count a difference, and describe it while there's room.
+         */
+        template<typename F>
+        static void record(ContainerDiff &diff, const DiffOptions &options, F &&describe) noexcept(false) {
+            if (diff.differences++ < options.maxDifferences) {
+                describe(diff.described.emplace_back());
+            }
+        }
+
+        template<typename A, typename E>
+        static void differs(std::string &text, std::string_view where, const A &actual, const E &expected) noexcept(false) {
+            text += where;
+            Format::element(text, actual);
+            text += " (expected ";
+            Format::element(text, expected);
+            text += ')';
+        }
+
+        template<typename T>
+        static void missing(std::string &text, std::string_view where, const T &expected) noexcept(false) {
+            text += where;
+            text += "missing (expected ";
+            Format::element(text, expected);
+            text += ')';
+        }
+
+        template<typename T>
+        static void unexpected(std::string &text, std::string_view where, const T &actual) noexcept(false) {
+            text += where;
+            Format::element(text, actual);
+            text += " (unexpected)";
+        }
+
+        static std::string at(size_t index) noexcept(false) {
+            std::string text = "[";
+            Format::number(text, index);
+            return text + "] ";
+        }
+
+        template<typename K>
+        static std::string key(const K &value) noexcept(false) {
+            std::string text = "[";
+            Format::element(text, value);
+            return text + "] ";
+        }
+    };
+}
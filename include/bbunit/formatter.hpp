@@ -0,0 +1,213 @@
+/**
+ * C++ BBUnit - Value formatting
+ *
+ * Renders expected and actual values as text for the results, and is the
+ * customization point for rendering your own types.
+ */
+
+#pragma once
+
+#include <charconv>
+#include <concepts>
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <ostream>
+#include <ranges>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#if __has_include(<format>)
+#include <format>
+#endif
+
+namespace BBUnit {
+    /**
+     * Renders a value of type ``T`` by appending it to a string.
+     *
+     * Numbers are rendered with ``std::to_chars`` (without allocating, and
+     * regardless of the locale), and enums as their underlying value. Strings,
+     * pointers, optionals, tuples and ranges are supported too, along with
+     * types which can be written to a ``std::ostream`` (or, where available,
+     * have a ``std::formatter``). Anything else is rendered as ``<Value>``.
+     *
+     * Specialize it to render your own types:
+     *
+     * ````cpp
+     * template<>
+     * struct BBUnit::Formatter<Point> {
+     *     static void format(std::string &out, const Point &point) {
+     *         out += "(";
+     *         Formatter<int>::format(out, point.x);
+     *         out += ", ";
+     *         Formatter<int>::format(out, point.y);
+     *         out += ")";
+     *     }
+     * };
+     * ````
+     *
+     * @tparam T
+     */
+    template<typename T>
+    struct Formatter {
+        /**
+         * Append ``value`` to ``out``.
+         *
+         * @param out
+         * @param value
+         */
+        static void format(std::string &out, const T &value) noexcept(false);
+    };
+
+    /**
+     * Helpers around ``Formatter``.
+     */
+    class Format {
+    public:
+        /**
+         * Largest number of elements of a range to render. The rest are counted.
+         */
+        static constexpr size_t maxElements = 32;
+
+        /**
+         * Append a value to ``out``, such as ``abc`` or ``[1, 2]``.
+         *
+         * @tparam T
+         * @param out
+         * @param value
+         */
+        template<typename T>
+        static void append(std::string &out, const T &value) noexcept(false) {
+            Formatter<std::remove_cvref_t<T>>::format(out, value);
+        }
+
+        /**
+         * Append a value to ``out`` as an element of a range or tuple, where strings
+         * and characters are quoted, such as ``"abc"`` and ``'a'``.
+         *
+         * @tparam T
+         * @param out
+         * @param value
+         */
+        template<typename T>
+        static void element(std::string &out, const T &value) noexcept(false) {
+            using V = std::remove_cvref_t<T>;
+            if constexpr (std::is_same_v<V, char>) {
+                out += '\'';
+                out += value;
+                out += '\'';
+            } else if constexpr (std::is_convertible_v<const V &, std::string_view>) {
+                out += '"';
+                out += std::string_view(value);
+                out += '"';
+            } else {
+                Formatter<V>::format(out, value);
+            }
+        }
+
+        /**
+         * A value rendered as a string.
+         *
+         * @tparam T
+         * @param value
+         * @return
+         */
+        template<typename T>
+        [[nodiscard]] static std::string toString(const T &value) noexcept(false) {
+            std::string out;
+            append(out, value);
+            return out;
+        }
+
+        /**
+         * Append a number to ``out``, without allocating beyond ``out`` itself.
+         *
+         * @tparam T
+         * @param out
+         * @param value
+         * @param base Only used for integers.
+         */
+        template<typename T> requires std::is_arithmetic_v<T>
+        static void number(std::string &out, T value, int base = 10) noexcept(false) {
+            char digits[64];
+            std::to_chars_result result;
+            if constexpr (std::is_integral_v<T>) {
+                result = std::to_chars(digits, digits + sizeof(digits), value, base);
+            } else {
+                result = std::to_chars(digits, digits + sizeof(digits), value);
+            }
+            out.append(digits, result.ptr);
+        }
+    };
+
+    template<typename T>
+    void Formatter<T>::format(std::string &out, const T &value) noexcept(false) {
+        if constexpr (std::is_same_v<T, bool>) {
+            out += value ? "true" : "false";
+        } else if constexpr (std::is_same_v<T, char>) {
+            out += value;
+        } else if constexpr (std::is_arithmetic_v<T>) {
+            Format::number(out, value);
+        } else if constexpr (std::is_enum_v<T>) {
+            Format::number(out, static_cast<std::underlying_type_t<T>>(value));
+        } else if constexpr (std::is_convertible_v<const T &, std::string_view>) {
+            out += std::string_view(value);
+        } else if constexpr (std::is_null_pointer_v<T>) {
+            out += "nullptr";
+        } else if constexpr (std::is_pointer_v<T>) {
+            if (value == nullptr) {
+                out += "nullptr";
+            } else {
+                out += "0x";
+                Format::number(out, reinterpret_cast<uintptr_t>(value), 16);
+            }
+        } else if constexpr (requires { value.has_value(); *value; }) {
+            if (value.has_value()) {
+                Format::element(out, *value);
+            } else {
+                out += "<No value>";
+            }
+        } else if constexpr (requires { std::tuple_size<T>::value; } && !std::ranges::input_range<T>) {
+            out += '(';
+            std::apply([&](const auto &...elements) {
+                size_t i = 0;
+                auto add = [&](const auto &element) {
+                    out += i++ > 0 ? ", " : "";
+                    Format::element(out, element);
+                };
+                (add(elements), ...);
+            }, value);
+            out += ')';
+        } else if constexpr (std::ranges::input_range<T>) {
+            out += '[';
+            size_t count = 0;
+            for (const auto &element: value) {
+                if (count < Format::maxElements) {
+                    out += count > 0 ? ", " : "";
+                    Format::element(out, element);
+                }
+                ++count;
+            }
+            if (count > Format::maxElements) {
+                out += ", and ";
+                Format::number(out, count - Format::maxElements);
+                out += " more";
+            }
+            out += ']';
+#if defined(__cpp_lib_format) && __cpp_lib_format >= 202207L
+        } else if constexpr (std::formattable<T, char>) {
+            std::format_to(std::back_inserter(out), "{}", value);
+#endif
+        } else if constexpr (requires(std::ostream &stream) { stream << value; }) {
+            std::ostringstream stream;
+            stream << value;
+            out += stream.view();
+        } else {
+            out += "<Value>";
+        }
+    }
+}
@@ -0,0 +1,323 @@
+/**
+ * C++ BBUnit - Numeric comparisons
+ *
+ * Approximate equality of floating-point values and arrays, behind
+ * ``assertNear`` and ``assertAllClose``.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <string>
+
+#if defined(__AVX__) || defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <immintrin.h>
+#endif
+
+#include "formatter.hpp"
+
+namespace BBUnit {
+    /**
+     * How far apart two floating-point values may be, and still count as equal.
+     *
+     * The values are equal when they're within any of the tolerances. With all
+     * tolerances at zero, only identical values are equal.
+     */
+    struct Tolerance {
+        /**
+         * Largest absolute difference, such as ``1e-9``.
+         */
+        double absolute = 0;
+
+        /**
+         * Largest difference, relative to the larger of the magnitudes, such as ``1e-6``.
+         */
+        double relative = 0;
+
+        /**
+         * Largest number of representable values between them (units in the last place).
+         */
+        uint64_t ulps = 0;
+
+        /**
+         * When true, NaN is equal to NaN.
+         */
+        bool nanEqual = false;
+
+        /**
+         * Human-readable summary, such as "abs 1e-09, 4 ulps".
+         *
+         * @return
+         */
+        [[nodiscard]] std::string describe() const noexcept(false) {
+            std::string text;
+            auto add = [&](const std::string &part) {
+                text += (text.empty() ? "" : ", ") + part;
+            };
+            if (absolute > 0) {
+                add("abs " + Format::toString(absolute));
+            }
+            if (relative > 0) {
+                add("rel " + Format::toString(relative));
+            }
+            if (ulps > 0) {
+                add(std::to_string(ulps) + " ulps");
+            }
+            return text.empty() ? "exact" : text;
+        }
+    };
+
+    /**
+     * Outcome of comparing two arrays element by element.
+     */
+    struct Closeness {
+        /**
+         * Number of elements compared.
+         */
+        size_t count = 0;
+
+        /**
+         * Number of elements which aren't equal within the tolerance.
+         */
+        size_t mismatches = 0;
+
+        /**
+         * Index of the first mismatch.
+         */
+        size_t firstMismatch = 0;
+
+        /**
+         * Largest absolute difference among the mismatches (infinite for NaN),
+         * and where it is.
+         */
+        double maxError = 0;
+        size_t maxErrorIndex = 0;
+
+        [[nodiscard]] bool passed() const noexcept {
+            return mismatches == 0;
+        }
+    };
+
+    namespace Internal {
+        /**
+         * Vectorized first pass of the comparison: for a block of ``width`` elements,
+         * a bitmask of the elements within the absolute or relative tolerance.
+         * Elements outside (or NaN) are checked one by one afterward.
+         *
+         * Only available for the instruction sets enabled at compile time, which
+         * is SSE2 on any x86-64 target, and AVX with e.g. ``-mavx`` or ``-march=native``.
+         * Otherwise, ``width`` is ``0``, and every element is checked one by one.
+         */
+        template<typename T>
+        struct Simd {
+            static constexpr size_t width = 0;
+        };
+
+#if defined(__AVX__)
+        template<>
+        struct Simd<float> {
+            static constexpr size_t width = 8;
+
+            static unsigned int within(const float *expected, const float *actual, float absolute, float relative) noexcept {
+                const __m256 sign = _mm256_set1_ps(-0.0f);
+                __m256 e = _mm256_loadu_ps(expected), a = _mm256_loadu_ps(actual);
+                __m256 diff = _mm256_andnot_ps(sign, _mm256_sub_ps(a, e));
+                __m256 magnitude = _mm256_max_ps(_mm256_andnot_ps(sign, e), _mm256_andnot_ps(sign, a));
+                __m256 limit = _mm256_max_ps(_mm256_set1_ps(absolute), _mm256_mul_ps(_mm256_set1_ps(relative), magnitude));
+                return static_cast<unsigned int>(_mm256_movemask_ps(_mm256_cmp_ps(diff, limit, _CMP_LE_OQ)));
+            }
+        };
+
+        template<>
+        struct Simd<double> {
+            static constexpr size_t width = 4;
+
+            static unsigned int within(const double *expected, const double *actual, double absolute, double relative) noexcept {
+                const __m256d sign = _mm256_set1_pd(-0.0);
+                __m256d e = _mm256_loadu_pd(expected), a = _mm256_loadu_pd(actual);
+                __m256d diff = _mm256_andnot_pd(sign, _mm256_sub_pd(a, e));
+                __m256d magnitude = _mm256_max_pd(_mm256_andnot_pd(sign, e), _mm256_andnot_pd(sign, a));
+                __m256d limit = _mm256_max_pd(_mm256_set1_pd(absolute), _mm256_mul_pd(_mm256_set1_pd(relative), magnitude));
+                return static_cast<unsigned int>(_mm256_movemask_pd(_mm256_cmp_pd(diff, limit, _CMP_LE_OQ)));
+            }
+        };
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+        template<>
+        struct Simd<float> {
+            static constexpr size_t width = 4;
+
+            static unsigned int within(const float *expected, const float *actual, float absolute, float relative) noexcept {
+                const __m128 sign = _mm_set1_ps(-0.0f);
+                __m128 e = _mm_loadu_ps(expected), a = _mm_loadu_ps(actual);
+                __m128 diff = _mm_andnot_ps(sign, _mm_sub_ps(a, e));
+                __m128 magnitude = _mm_max_ps(_mm_andnot_ps(sign, e), _mm_andnot_ps(sign, a));
+                __m128 limit = _mm_max_ps(_mm_set1_ps(absolute), _mm_mul_ps(_mm_set1_ps(relative), magnitude));
+                return static_cast<unsigned int>(_mm_movemask_ps(_mm_cmple_ps(diff, limit)));
+            }
+        };
+
+        template<>
+        struct Simd<double> {
+            static constexpr size_t width = 2;
+
+            static unsigned int within(const double *expected, const double *actual, double absolute, double relative) noexcept {
+                const __m128d sign = _mm_set1_pd(-0.0);
+                __m128d e = _mm_loadu_pd(expected), a = _mm_loadu_pd(actual);
+                __m128d diff = _mm_andnot_pd(sign, _mm_sub_pd(a, e));
+                __m128d magnitude = _mm_max_pd(_mm_andnot_pd(sign, e), _mm_andnot_pd(sign, a));
+                __m128d limit = _mm_max_pd(_mm_set1_pd(absolute), _mm_mul_pd(_mm_set1_pd(relative), magnitude));
+                return static_cast<unsigned int>(_mm_movemask_pd(_mm_cmple_pd(diff, limit)));
+            }
+        };
+#endif
+    }
+
+    /**
+     * Approximate equality of floating-point values.
+     */
+    class Numeric {
+    public:
+        /**
+         * Whether two values are equal within the tolerance.
+         *
+         * @tparam T
+         * @param expected
+         * @param actual
+         * @param tolerance
+         * @return
+         */
+        template<std::floating_point T>
+        [[nodiscard]] static bool near(T expected, T actual, const Tolerance &tolerance) noexcept {
+            if (expected == actual) {
+                return true;
+            }
+            if (std::isnan(expected) || std::isnan(actual)) {
+                return tolerance.nanEqual && std::isnan(expected) && std::isnan(actual);
+            }
+
+            T diff = std::abs(actual - expected);
+            T magnitude = std::max(std::abs(expected), std::abs(actual));
+            return diff <= static_cast<T>(tolerance.absolute)
+                   || diff <= static_cast<T>(tolerance.relative) * magnitude
+                   || (tolerance.ulps > 0 && ulpDistance(expected, actual) <= tolerance.ulps);
+        }
+
+        /**
+         * Number of representable values between ``a`` and ``b``. ``long double`` is
+         * measured in ``double`` steps.
+         *
+         * @tparam T
+         * @param a
+         * @param b
+         * @return
+         */
+        template<std::floating_point T>
+        [[nodiscard]] static uint64_t ulpDistance(T a, T b) noexcept {
+            if (std::isnan(a) || std::isnan(b)) {
+                return std::numeric_limits<uint64_t>::max();
+            }
+            if constexpr (std::is_same_v<T, float>) {
+                return distance(ordered(std::bit_cast<int32_t>(a)), ordered(std::bit_cast<int32_t>(b)));
+            } else if constexpr (std::is_same_v<T, double>) {
+                return distance(ordered(std::bit_cast<int64_t>(a)), ordered(std::bit_cast<int64_t>(b)));
+            } else {
+                return ulpDistance(static_cast<double>(a), static_cast<double>(b));
+            }
+        }
+
+        /**
+         * Compare two arrays of the same size element by element.
+         *
+         * Blocks of elements are first compared with SIMD instructions (see
+         * ``Internal::Simd``), and only the elements which don't pass that are
+         * compared one by one, including the ULP tolerance.
+         *
+         * @tparam T
+         * @param expected
+         * @param actual
+         * @param tolerance
+         * @return
+         */
+        template<std::floating_point T>
+        [[nodiscard]] static Closeness compare(std::span<const T> expected,
+                                               std::span<const T> actual,
+                                               const Tolerance &tolerance) noexcept {
+            const size_t count = std::min(expected.size(), actual.size());
+            const T *e = expected.data(), *a = actual.data();
+            Closeness result;
+            result.count = count;
+
+            auto check = [&](size_t i) {
+                if (near(e[i], a[i], tolerance)) {
+                    return;
+                }
+                T diff = std::abs(a[i] - e[i]);
+                double error = std::isnan(diff) ? std::numeric_limits<double>::infinity() : static_cast<double>(diff);
+                if (result.mismatches++ == 0) {
+                    result.firstMismatch = i;
+                }
+                if (error > result.maxError || result.mismatches == 1) {
+                    result.maxError = error;
+                    result.maxErrorIndex = i;
+                }
+            };
+
+            size_t i = 0;
+            if constexpr (Internal::Simd<T>::width > 0) {
+                constexpr size_t width = Internal::Simd<T>::width;
+                constexpr unsigned int all = (1u << width) - 1;
+                auto absolute = static_cast<T>(tolerance.absolute), relative = static_cast<T>(tolerance.relative);
+                for (const size_t blocks = count - count % width; i < blocks; i += width) {
+                    unsigned int within = Internal::Simd<T>::within(e + i, a + i, absolute, relative);
+                    if (within != all) {
+                        for (size_t lane = 0; lane < width; ++lane) {
+                            if (!(within & (1u << lane))) {
+                                check(i + lane);
+                            }
+                        }
+                    }
+                }
+            }
+            for (; i < count; ++i) {
+                check(i);
+            }
+            return result;
+        }
+
+        /**
+         * Render a value with as many digits as needed to tell it apart from
+         * its neighbours.
+         *
+         * @tparam T
+         * @param value
+         * @return
+         */
+        template<std::floating_point T>
+        [[nodiscard]] static std::string format(T value) noexcept(false) {
+            std::string text;
+            Format::number(text, value);
+            return text;
+        }
+
+    private:
+        /**
+         * Map the bits of a float to integers in the same order as the floats.
+         */
+        template<std::signed_integral I>
+        static I ordered(I bits) noexcept {
+            return bits < 0 ? static_cast<I>(std::numeric_limits<I>::min() - bits) : bits;
+        }
+
+        template<std::signed_integral I>
+        static uint64_t distance(I a, I b) noexcept {
+            return a > b ? static_cast<uint64_t>(a) - static_cast<uint64_t>(b)
+                         : static_cast<uint64_t>(b) - static_cast<uint64_t>(a);
+        }
+    };
+}
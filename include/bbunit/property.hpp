@@ -0,0 +1,627 @@
+/**
+ * C++ BBUnit - Property-based testing
+ *
+ * Random number generation, generators of random inputs (which also know
+ * how to shrink them), and the engine behind ``TestCase::forAll``.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <random>
+#include <ranges>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "formatter.hpp"
+#include "utilities/thread-pool.hpp"
+
+namespace BBUnit {
+    /**
+     * Small, fast pseudo-random number generator (xoshiro256**).
+     *
+     * The same seed and stream always produce the same numbers, on every
+     * platform, which is what makes failing properties reproducible.
+     */
+    class Random {
+    public:
+        /**
+         * @param seed
+         * @param stream Selects one of many independent sequences for the same seed.
+         */
+        explicit Random(uint64_t seed, uint64_t stream = 0) noexcept {
+            uint64_t x = seed ^ (stream * 0xD1B54A32D192ED03ull);
+            for (uint64_t &state: m_state) {
+                state = splitMix(x);
+            }
+        }
+
+        uint64_t next() noexcept {
+            uint64_t result = rotate(m_state[1] * 5, 7) * 9;
+            uint64_t t = m_state[1] << 17;
+            m_state[2] ^= m_state[0];
+            m_state[3] ^= m_state[1];
+            m_state[1] ^= m_state[2];
+            m_state[0] ^= m_state[3];
+            m_state[2] ^= t;
+            m_state[3] = rotate(m_state[3], 45);
+            return result;
+        }
+
+        /**
+         * A number in ``[0, bound)``. A ``bound`` of ``0`` stands for 2^64.
+         *
+         * @param bound
+         * @return
+         */
+        uint64_t below(uint64_t bound) noexcept {
+            if (bound == 0) {
+                return next();
+            }
+#ifdef __SIZEOF_INT128__
+            // Multiply-shift, which avoids the (slow) division of the modulo.
+            // 128-bit integers are an extension, which ``-Wpedantic`` warns about.
+            __extension__ using Wide = unsigned __int128;
+            return static_cast<uint64_t>((static_cast<Wide>(next()) * bound) >> 64);
+#else
+            return next() % bound;
+#endif
+        }
+
+        /**
+         * A number in ``[min, max]``.
+         *
+         * @tparam T
+         * @param min
+         * @param max
+         * @return
+         */
+        template<std::integral T>
+        T between(T min, T max) noexcept {
+            using U = std::make_unsigned_t<T>;
+            auto range = static_cast<uint64_t>(static_cast<U>(static_cast<U>(max) - static_cast<U>(min)));
+            return static_cast<T>(static_cast<U>(static_cast<U>(min) + static_cast<U>(below(range + 1))));
+        }
+
+        /**
+         * A number in ``[0, 1)``.
+         *
+         * @return
+         */
+        double unit() noexcept {
+            return static_cast<double>(next() >> 11) * 0x1.0p-53;
+        }
+
+    private:
+        uint64_t m_state[4];
+
+        static uint64_t rotate(uint64_t x, int k) noexcept {
+            return (x << k) | (x >> (64 - k));
+        }
+
+        static uint64_t splitMix(uint64_t &x) noexcept {
+            uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            return z ^ (z >> 31);
+        }
+    };
+
+    /**
+     * Concept of a generator of random inputs for ``forAll``.
+     *
+     * ``generate`` writes a random value into ``value``, which holds a value from
+     * an earlier call, so its memory can be reused. ``size`` grows from ``0`` during
+     * a run, and limits the size of e.g. strings and vectors.
+     *
+     * ``shrink`` returns "smaller" variants of a value, most aggressive first.
+     */
+    template<typename G>
+    concept Generator = requires(const G &generator, Random &random, size_t size, typename G::value_type &value) {
+        generator.generate(random, size, value);
+        { generator.shrink(value) } -> std::convertible_to<std::vector<typename G::value_type>>;
+    };
+
+    /**
+     * Options for how properties are checked by ``forAll``.
+     */
+    struct PropertyOptions {
+        /**
+         * Number of random inputs the property is checked with.
+         */
+        size_t iterations = 1000;
+
+        /**
+         * Seed of the random inputs. When ``0``, a seed is picked at random,
+         * and reported when the property fails, so the run can be reproduced.
+         */
+        uint64_t seed = 0;
+
+        /**
+         * Largest ``size`` handed to the generators, reached by the last inputs.
+         */
+        size_t maxSize = 100;
+
+        /**
+         * Largest number of candidates tried while shrinking a failing input.
+         */
+        size_t maxShrinks = 1000;
+
+        /**
+         * Number of threads checking the inputs. The property must be thread-safe,
+         * when above ``1``. The inputs, and therefore the reported counterexample,
+         * are the same regardless of the number of threads.
+         */
+        unsigned int threads = 1;
+    };
+
+    /**
+     * Built-in generators for ``forAll``.
+     */
+    namespace Generators {
+        /**
+         * Integers in ``[min, max]``, shrunk toward zero (or the bound closest to it).
+         */
+        template<std::integral T> requires (!std::same_as<T, bool>)
+        class Integers {
+        public:
+            using value_type = T;
+
+            explicit Integers(T min = std::numeric_limits<T>::min(),
+                              T max = std::numeric_limits<T>::max()) noexcept : m_min(min), m_max(max) {}
+
+            void generate(Random &random, size_t, T &value) const noexcept {
+                // Now and then, pick one of the edge cases, which are easily missed otherwise
+                if (random.below(16) == 0) {
+                    T edges[] = {m_min, m_max, target()};
+                    value = edges[random.below(3)];
+                    return;
+                }
+                value = random.between(m_min, m_max);
+            }
+
+            [[nodiscard]] std::vector<T> shrink(T value) const noexcept(false) {
+                using U = std::make_unsigned_t<T>;
+                T to = target();
+                std::vector<T> candidates;
+                if (value == to) {
+                    return candidates;
+                }
+
+                // The target itself, then halfway there, a quarter of the way, etc.
+                bool down = value > to;
+                U distance = down ? static_cast<U>(static_cast<U>(value) - static_cast<U>(to))
+                                  : static_cast<U>(static_cast<U>(to) - static_cast<U>(value));
+                candidates.push_back(to);
+                for (U step = distance / 2; step > 0; step /= 2) {
+                    candidates.push_back(static_cast<T>(down ? static_cast<U>(static_cast<U>(value) - step)
+                                                             : static_cast<U>(static_cast<U>(value) + step)));
+                }
+                return candidates;
+            }
+
+        private:
+            T m_min, m_max;
+
+            [[nodiscard]] T target() const noexcept {
+                return std::clamp(T(0), m_min, m_max);
+            }
+        };
+
+        /**
+         * Floating-point numbers in ``[min, max]``, shrunk toward zero (or the
+         * bound closest to it) and toward whole numbers.
+         */
+        template<std::floating_point T>
+        class Floats {
+        public:
+            using value_type = T;
+
+            explicit Floats(T min = -1e6, T max = 1e6) noexcept : m_min(min), m_max(max) {}
+
+            void generate(Random &random, size_t, T &value) const noexcept {
+                if (random.below(16) == 0) {
+                    T edges[] = {m_min, m_max, target()};
+                    value = edges[random.below(3)];
+                    return;
+                }
+                value = std::clamp(static_cast<T>(m_min + (m_max - m_min) * static_cast<T>(random.unit())), m_min, m_max);
+            }
+
+            [[nodiscard]] std::vector<T> shrink(T value) const noexcept(false) {
+                T to = target();
+                std::vector<T> candidates;
+                if (value == to || !std::isfinite(value)) {
+                    return candidates;
+                }
+
+                candidates.push_back(to);
+                T whole = std::trunc(value);
+                if (whole != value && whole >= m_min && whole <= m_max) {
+                    candidates.push_back(whole);
+                }
+
+                // Whole numbers halfway to the target, a quarter of the way, etc.
+                T distance = std::abs(whole - to);
+                for (T step = std::floor(distance / 2); step >= 1; step = std::floor(step / 2)) {
+                    T candidate = whole > to ? whole - step : whole + step;
+                    if (candidate >= m_min && candidate <= m_max) {
+                        candidates.push_back(candidate);
+                    }
+                }
+                return candidates;
+            }
+
+        private:
+            T m_min, m_max;
+
+            [[nodiscard]] T target() const noexcept {
+                return std::clamp(T(0), m_min, m_max);
+            }
+        };
+
+        /**
+         * Strings of up to ``maxLength`` characters from an alphabet (printable
+         * ASCII by default). Shrunk by removing characters, and replacing them
+         * with the first character of the alphabet.
+         */
+        class Strings {
+        public:
+            using value_type = std::string;
+
+            /**
+             * @throws std::invalid_argument When the alphabet is empty.
+             * @param maxLength
+             * @param alphabet
+             */
+            explicit Strings(size_t maxLength = 32, std::string alphabet = printable())
+                    : m_maxLength(maxLength), m_alphabet(std::move(alphabet)) {
+                if (m_alphabet.empty()) {
+                    throw std::invalid_argument("The alphabet of Strings can't be empty");
+                }
+            }
+
+            void generate(Random &random, size_t size, std::string &value) const noexcept(false) {
+                value.resize(random.below(std::min(m_maxLength, size) + 1));
+                for (char &c: value) {
+                    c = m_alphabet[random.below(m_alphabet.size())];
+                }
+            }
+
+            [[nodiscard]] std::vector<std::string> shrink(const std::string &value) const noexcept(false) {
+                std::vector<std::string> candidates;
+                shrinkSequence(value, candidates);
+                for (size_t i = 0; i < value.size(); ++i) {
+                    if (value[i] != m_alphabet.front()) {
+                        candidates.push_back(value);
+                        candidates.back()[i] = m_alphabet.front();
+                    }
+                }
+                return candidates;
+            }
+
+            /**
+             * Remove all, half, and single elements of a sequence.
+             *
+             * @tparam T
+             * @param value
+             * @param candidates
+             */
+            template<typename T>
+            static void shrinkSequence(const T &value, std::vector<T> &candidates) noexcept(false) {
+                if (value.empty()) {
+                    return;
+                }
+                candidates.emplace_back();
+                size_t half = value.size() / 2;
+                if (half > 0) {
+                    candidates.emplace_back(value.begin() + static_cast<std::ptrdiff_t>(half), value.end());
+                    candidates.emplace_back(value.begin(), value.begin() + static_cast<std::ptrdiff_t>(half));
+                }
+                for (size_t i = 0; i < value.size() && value.size() > 1; ++i) {
+                    candidates.push_back(value);
+                    candidates.back().erase(candidates.back().begin() + static_cast<std::ptrdiff_t>(i));
+                }
+            }
+
+        private:
+            size_t m_maxLength;
+
+            std::string m_alphabet;
+
+            static std::string printable() {
+                std::string alphabet;
+                for (char c = ' '; c <= '~'; ++c) {
+                    alphabet += c;
+                }
+                return alphabet;
+            }
+        };
+
+        /**
+         * Vectors of up to ``maxSize`` elements from another generator. Shrunk by
+         * removing elements, and by shrinking the individual elements.
+         */
+        template<Generator G>
+        class Vectors {
+        public:
+            using value_type = std::vector<typename G::value_type>;
+
+            explicit Vectors(G element, size_t maxSize = 32) : m_element(std::move(element)), m_maxSize(maxSize) {}
+
+            void generate(Random &random, size_t size, value_type &value) const noexcept(false) {
+                value.resize(random.below(std::min(m_maxSize, size) + 1));
+                for (auto &element: value) {
+                    m_element.generate(random, size, element);
+                }
+            }
+
+            [[nodiscard]] std::vector<value_type> shrink(const value_type &value) const noexcept(false) {
+                std::vector<value_type> candidates;
+                Strings::shrinkSequence(value, candidates);
+                for (size_t i = 0; i < value.size(); ++i) {
+                    for (auto &element: m_element.shrink(value[i])) {
+                        candidates.push_back(value);
+                        candidates.back()[i] = std::move(element);
+                    }
+                }
+                return candidates;
+            }
+
+        private:
+            G m_element;
+
+            size_t m_maxSize;
+        };
+
+        /**
+         * Optional values from another generator, which are empty one in
+         * ``emptyOneIn`` times. Shrunk to empty, and by shrinking the value.
+         */
+        template<Generator G>
+        class Optionals {
+        public:
+            using value_type = std::optional<typename G::value_type>;
+
+            explicit Optionals(G value, size_t emptyOneIn = 10) : m_value(std::move(value)), m_emptyOneIn(emptyOneIn) {}
+
+            void generate(Random &random, size_t size, value_type &value) const noexcept(false) {
+                if (random.below(m_emptyOneIn) == 0) {
+                    value.reset();
+                    return;
+                }
+                if (!value.has_value()) {
+                    value.emplace();
+                }
+                m_value.generate(random, size, *value);
+            }
+
+            [[nodiscard]] std::vector<value_type> shrink(const value_type &value) const noexcept(false) {
+                std::vector<value_type> candidates;
+                if (!value.has_value()) {
+                    return candidates;
+                }
+                candidates.emplace_back();
+                for (auto &shrunk: m_value.shrink(*value)) {
+                    candidates.emplace_back(std::move(shrunk));
+                }
+                return candidates;
+            }
+
+        private:
+            G m_value;
+
+            size_t m_emptyOneIn;
+        };
+    }
+
+    /**
+     * Outcome of checking a property.
+     */
+    struct PropertyOutcome {
+        bool passed = true;
+
+        /**
+         * Number of inputs checked, including the failing one.
+         */
+        size_t tests = 0;
+
+        /**
+         * Number of times the failing input was successfully shrunk.
+         */
+        size_t shrinks = 0;
+
+        /**
+         * Seed which reproduces the inputs.
+         */
+        uint64_t seed = 0;
+
+        /**
+         * The (shrunk) input which the property fails for, such as ``(3, "ab")``.
+         */
+        std::string counterexample;
+
+        /**
+         * Message of the exception, when the property threw one.
+         */
+        std::string error;
+    };
+
+    /**
+     * Check properties against random inputs.
+     */
+    class Property {
+    public:
+        /**
+         * Check that ``predicate`` returns true for ``options.iterations`` random inputs,
+         * and shrink the first input it fails for. An exception thrown by the predicate
+         * counts as failing.
+         *
+         * Input ``i`` is generated from the seed and ``i`` alone, so the inputs are the
+         * same regardless of how they're spread across threads.
+         *
+         * @tparam Predicate
+         * @tparam Gens
+         * @param options
+         * @param predicate
+         * @param generators
+         * @return
+         */
+        template<typename Predicate, Generator... Gens>
+        requires std::predicate<Predicate &, const typename Gens::value_type &...>
+        [[nodiscard]] static PropertyOutcome check(const PropertyOptions &options,
+                                                   Predicate &&predicate,
+                                                   const Gens &...generators) noexcept(false) {
+            using Values = std::tuple<typename Gens::value_type...>;
+
+            PropertyOutcome outcome;
+            outcome.seed = options.seed ? options.seed : randomSeed();
+
+            auto generate = [&](size_t index, Values &values) {
+                Random random(outcome.seed, index);
+                size_t size = options.iterations > 1
+                              ? static_cast<size_t>(static_cast<double>(options.maxSize) * static_cast<double>(index)
+                                                    / static_cast<double>(options.iterations - 1))
+                              : options.maxSize;
+                std::apply([&](auto &...value) {
+                    (generators.generate(random, size, value), ...);
+                }, values);
+            };
+
+            auto holds = [&](const Values &values, std::string &error) -> bool {
+                try {
+                    return std::apply([&](const auto &...value) -> bool {
+                        return predicate(value...);
+                    }, values);
+                } catch (const std::exception &e) {
+                    error = e.what();
+                } catch (...) {
+                    error = "<Unknown exception>";
+                }
+                return false;
+            };
+
+            size_t failing = findFailing<Values>(options, [&](size_t index, Values &values) {
+                std::string ignored;
+                generate(index, values);
+                return holds(values, ignored);
+            });
+            if (failing == options.iterations) {
+                outcome.tests = options.iterations;
+                return outcome;
+            }
+
+            Values values;
+            generate(failing, values);
+            outcome.passed = false;
+            outcome.tests = failing + 1;
+            holds(values, outcome.error);
+
+            // Shrink one argument at a time, restarting whenever a smaller input still fails
+            size_t attempts = 0;
+            auto shrinkArgument = [&]<size_t K>() -> bool {
+                for (auto &candidate: std::get<K>(std::tie(generators...)).shrink(std::get<K>(values))) {
+                    if (attempts++ >= options.maxShrinks) {
+                        return false;
+                    }
+                    Values smaller = values;
+                    std::get<K>(smaller) = std::move(candidate);
+                    std::string error;
+                    if (!holds(smaller, error)) {
+                        values = std::move(smaller);
+                        outcome.error = std::move(error);
+                        ++outcome.shrinks;
+                        return true;
+                    }
+                }
+                return false;
+            };
+            [&]<size_t... K>(std::index_sequence<K...>) {
+                while ((shrinkArgument.template operator()<K>() || ...)) {}
+            }(std::index_sequence_for<Gens...>());
+
+            outcome.counterexample = std::apply([](const auto &...value) {
+                std::string text;
+                ((text += (text.empty() ? "" : ", ") + describe(value)), ...);
+                return sizeof...(value) == 1 ? text : "(" + text + ")";
+            }, values);
+            return outcome;
+        }
+
+        /**
+         * Render a generated value, such as ``"ab"``, ``[1, 2]`` or ``(1, "ab")``.
+         *
+         * @tparam T
+         * @param value
+         * @return
+         */
+        template<typename T>
+        [[nodiscard]] static std::string describe(const T &value) noexcept(false) {
+            std::string text;
+            Format::element(text, value);
+            return text;
+        }
+
+    private:
+        /**
+         * Find the first of ``options.iterations`` inputs which ``check`` fails for.
+         *
+         * @return The index of the input, or ``options.iterations`` when all pass.
+         */
+        template<typename Values, typename Check>
+        static size_t findFailing(const PropertyOptions &options, Check &&check) noexcept(false) {
+            if (options.threads <= 1) {
+                Values values;
+                for (size_t i = 0; i < options.iterations; ++i) {
+                    if (!check(i, values)) {
+                        return i;
+                    }
+                }
+                return options.iterations;
+            }
+
+            // Inputs are claimed in chunks. Inputs before a failure are still checked,
+            // so the first failing input is found, as when checking serially.
+            constexpr size_t chunk = 64;
+            std::atomic<size_t> next = 0, first = options.iterations;
+            Utilities::ThreadPool pool(options.threads);
+            pool.forEach(pool.size(), [&](size_t) {
+                Values values;
+                for (size_t from = next.fetch_add(chunk); from < first.load(); from = next.fetch_add(chunk)) {
+                    for (size_t i = from; i < std::min(from + chunk, options.iterations); ++i) {
+                        if (i >= first.load(std::memory_order_relaxed)) {
+                            break;
+                        }
+                        if (!check(i, values)) {
+                            size_t current = first.load();
+                            while (i < current && !first.compare_exchange_weak(current, i)) {}
+                            break;
+                        }
+                    }
+                }
+            });
+            return first.load();
+        }
+
+        static uint64_t randomSeed() noexcept(false) {
+            // 32 bits, so the seed is easy to pass on the command line
+            uint64_t seed;
+            do {
+                seed = std::random_device()();
+            } while (seed == 0);
+            return seed;
+        }
+    };
+}
@@ -0,0 +1,117 @@
+/**
+ * C++ BBUnit - Command-line utility
+ *
+ * Reads the runner's settings from the arguments of the test executable,
+ * so CI jobs can choose e.g. a shard without recompiling.
+ */
+
+#pragma once
+
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "../bbunit.hpp"
+
+namespace BBUnit::Utilities {
+    /**
+     * Command-line options.
+     *
+     * | Option                | Setting                           |
+     * |-----------------------|-----------------------------------|
+     * | ``--shard-index N``   | ``Settings::shardIndex``          |
+     * | ``--shard-count N``   | ``Settings::shardCount``          |
+     * | ``--timings FILE``    | ``Settings::caseDurations``       |
+     * | ``--case PATTERNS``   | ``Settings::caseFilter``          |
+     * | ``--it PATTERNS``     | ``Settings::itFilter``            |
+     * | ``--list``            | ``Settings::listOnly``            |
+     * | ``--results-db FILE`` | ``Settings::resultsDatabase``     |
+     * | ``--rerun-failed``    | ``Settings::rerunFailed``         |
+     * | ``--changed-only``    | ``Settings::changedOnly``         |
+     * | ``--counters``        | ``Settings::countHardwareEvents`` |
+     * | ``--seed N``          | ``PropertyOptions::seed``         |
+     *
+     * Values can also be given on the form ``--shard-index=N``.
+     *
+     * The filters can also be given in the environment variables ``BBUNIT_CASE``
+     * and ``BBUNIT_IT``, which are overridden by the command line.
+     */
+    class CommandLine {
+    public:
+        /**
+         * Apply the options found in ``argv`` to the settings. Arguments
+         * which aren't recognized are left for the application.
+         *
+         * @throws std::invalid_argument When an option has a missing or invalid value.
+         * @param argc
+         * @param argv
+         * @param settings
+         */
+        static void apply(int argc, const char *const *argv, Settings &settings) noexcept(false) {
+            if (const char *patterns = std::getenv("BBUNIT_CASE")) {
+                settings.caseFilter = NameFilter(patterns);
+            }
+            if (const char *patterns = std::getenv("BBUNIT_IT")) {
+                settings.itFilter = NameFilter(patterns);
+            }
+
+            for (int i = 1; i < argc; ++i) {
+                std::string_view arg = argv[i];
+                std::string_view name = arg.substr(0, arg.find('='));
+
+                auto value = [&]() -> std::string {
+                    if (name.size() < arg.size()) {
+                        return std::string(arg.substr(name.size() + 1));
+                    }
+                    if (i + 1 >= argc) {
+                        throw std::invalid_argument("Missing value for " + std::string(name));
+                    }
+                    return argv[++i];
+                };
+
+                if (name == "--shard-index") {
+                    settings.shardIndex = static_cast<unsigned int>(toNumber(name, value()));
+                } else if (name == "--shard-count") {
+                    settings.shardCount = static_cast<unsigned int>(toNumber(name, value(), UINT32_MAX, 1));
+                } else if (name == "--timings") {
+                    settings.caseDurations = std::make_shared<CaseDurations>(value());
+                } else if (name == "--case") {
+                    settings.caseFilter = NameFilter(value());
+                } else if (name == "--it") {
+                    settings.itFilter = NameFilter(value());
+                } else if (arg == "--list") {
+                    settings.listOnly = true;
+                } else if (name == "--results-db") {
+                    settings.resultsDatabase = std::make_shared<ResultsDatabase>(value());
+                } else if (arg == "--rerun-failed") {
+                    settings.rerunFailed = true;
+                } else if (arg == "--changed-only") {
+                    settings.changedOnly = true;
+                } else if (arg == "--counters") {
+                    settings.countHardwareEvents = true;
+                } else if (name == "--seed") {
+                    settings.propertyOptions.seed = toNumber(name, value(), UINT64_MAX);
+                }
+            }
+        }
+
+    private:
+        static unsigned long long toNumber(std::string_view name,
+                                           const std::string &value,
+                                           unsigned long long max = UINT32_MAX,
+                                           unsigned long long min = 0) noexcept(false) {
+            size_t end = 0;
+            unsigned long long number = 0;
+            try {
+                number = std::stoull(value, &end);
+            } catch (const std::exception &) {
+                end = 0;
+            }
+            if (value.empty() || end != value.size() || value[0] == '-' || number < min || number > max) {
+                throw std::invalid_argument("Invalid value for " + std::string(name) + ": " + value);
+            }
+            return number;
+        }
+    };
+}
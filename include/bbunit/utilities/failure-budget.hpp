@@ -0,0 +1,75 @@
+/**
+ * C++ BBUnit - Failure budget utility
+ *
+ * Counts failures across all threads of a run, so the run can be
+ * cancelled once a limit is reached.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+namespace BBUnit::Utilities {
+    /**
+     * Thread-safe failure counter, which is exhausted when it reaches
+     * its limit (or is cancelled explicitly).
+     */
+    class FailureBudget {
+    public:
+        /**
+         * @param maxFailures Number of failures allowed. When ``0``, the budget
+         *      is only exhausted by ``cancel``.
+         */
+        explicit FailureBudget(size_t maxFailures = 0) noexcept : m_maxFailures(maxFailures) {}
+
+        /**
+         * Count a number of failures.
+         *
+         * @param count
+         * @return True, if the budget is exhausted.
+         */
+        bool fail(size_t count = 1) noexcept {
+            if (count == 0) {
+                return exhausted();
+            }
+            size_t failures = m_failures.fetch_add(count, std::memory_order_relaxed) + count;
+            if (m_maxFailures && failures >= m_maxFailures) {
+                m_cancelled.store(true, std::memory_order_relaxed);
+            }
+            return exhausted();
+        }
+
+        /**
+         * Exhaust the budget, regardless of the number of failures.
+         */
+        void cancel() noexcept {
+            m_cancelled.store(true, std::memory_order_relaxed);
+        }
+
+        /**
+         * Whether the run should stop.
+         *
+         * @return
+         */
+        [[nodiscard]] bool exhausted() const noexcept {
+            return m_cancelled.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Number of failures counted so far.
+         *
+         * @return
+         */
+        [[nodiscard]] size_t failures() const noexcept {
+            return m_failures.load(std::memory_order_relaxed);
+        }
+
+    private:
+        size_t m_maxFailures;
+
+        std::atomic<size_t> m_failures = 0;
+
+        std::atomic<bool> m_cancelled = false;
+    };
+}
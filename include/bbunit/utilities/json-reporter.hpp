@@ -0,0 +1,210 @@
+/**
+ * C++ BBUnit - JSON-lines reporter
+ *
+ * Writes the results as JSON lines (one JSON object per line), for
+ * dashboards and other tools.
+ */
+
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include "../bbunit.hpp"
+#include "output-buffer.hpp"
+
+namespace BBUnit::Utilities {
+    /**
+     * JSON reporter settings
+     */
+    struct JsonReporterSettings {
+        /**
+         * When true, passed assertions are reported too. Otherwise only failed
+         * assertions and errors are, along with the scopes and test cases.
+         */
+        bool includePassed = false;
+    };
+
+    /**
+     * Sink which writes a line for every reported assertion, every completed
+     * ``it`` scope and test case, and a summary at the end of the run:
+     *
+     * ````json
+     * {"type":"assertion","testCase":"MyTest","description":"Adds","caseNo":2,"status":"failed","expected":"4","actual":"5"}
+     * {"type":"scope","testCase":"MyTest","description":"Adds","wallNs":1200,"cpuNs":1100}
+     * {"type":"case","testCase":"MyTest","wallNs":5300,"cpuNs":5000}
+     * {"type":"summary","passed":12,"failed":1,"errors":0}
+     * ````
+     *
+     * Errors have ``"status":"error"``, along with ``error`` (see ``errorCodeName``)
+     * and ``message``. When hardware events are counted (see ``Settings::countHardwareEvents``),
+     * scopes have ``cycles``, ``instructions``, ``cacheMisses`` and ``branchMisses``.
+     */
+    class JsonLinesReporter : public ResultSink {
+    public:
+        /**
+         * Write to a file descriptor (for example ``1`` for stdout).
+         *
+         * @param fd
+         * @param settings
+         */
+        explicit JsonLinesReporter(int fd, const JsonReporterSettings &settings = {})
+                : m_out(fd), m_settings(settings) {}
+
+        /**
+         * Write to a file.
+         *
+         * @param path
+         * @param settings
+         */
+        explicit JsonLinesReporter(const std::string &path, const JsonReporterSettings &settings = {})
+                : m_out(path), m_settings(settings) {}
+
+        /**
+         * Append a string to the output as a JSON string literal, including quotes.
+         *
+         * @param out
+         * @param text
+         */
+        static void appendString(OutputBuffer &out, std::string_view text) noexcept(false) {
+            out.append('"');
+            size_t plain = 0;
+            for (size_t i = 0; i < text.size(); ++i) {
+                auto c = static_cast<unsigned char>(text[i]);
+                if (c >= 0x20 && c != '"' && c != '\\') {
+                    continue;
+                }
+
+                // Copy the run of characters which don't need escaping in one go
+                out.append(text.substr(plain, i - plain));
+                plain = i + 1;
+                switch (c) {
+                    case '"':
+                        out.append("\\\"");
+                        break;
+                    case '\\':
+                        out.append("\\\\");
+                        break;
+                    case '\n':
+                        out.append("\\n");
+                        break;
+                    case '\r':
+                        out.append("\\r");
+                        break;
+                    case '\t':
+                        out.append("\\t");
+                        break;
+                    default:
+                        static constexpr char hex[] = "0123456789abcdef";
+                        char escaped[] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF]};
+                        out.append(std::string_view(escaped, sizeof(escaped)));
+                }
+            }
+            out.append(text.substr(plain));
+            out.append('"');
+        }
+
+    protected:
+        void consume(TestResults &&results) override {
+            for (ResultRef result: results) {
+                bool passed = result.passed();
+                if (result.isErr()) {
+                    ++m_errors;
+                } else if (passed) {
+                    ++m_passed;
+                } else {
+                    ++m_failed;
+                }
+
+                if (passed && !m_settings.includePassed) {
+                    continue;
+                }
+
+                m_out.append(R"({"type":"assertion","testCase":)");
+                appendString(m_out, result.testCase());
+                m_out.append(R"(,"description":)");
+                appendString(m_out, result.description());
+                m_out.append(R"(,"caseNo":)");
+                m_out.appendNumber(result.caseNo());
+                m_out.append(R"(,"status":)");
+                m_out.append(passed ? R"("passed")" : result.isErr() ? R"("error")" : R"("failed")");
+                if (result.isErr()) {
+                    m_out.append(R"(,"error":")");
+                    m_out.append(errorCodeName(result.errorCode()));
+                    m_out.append(R"(","message":)");
+                    appendString(m_out, result.message());
+                } else if (!result.expected().empty() || !result.actual().empty()) {
+                    m_out.append(R"(,"expected":)");
+                    appendString(m_out, result.expected());
+                    m_out.append(R"(,"actual":)");
+                    appendString(m_out, result.actual());
+                }
+                if (!result.additional().empty()) {
+                    m_out.append(R"(,"additional":)");
+                    appendString(m_out, result.additional());
+                }
+                m_out.append("}\n");
+            }
+
+            // Scopes handed over in several batches are only complete (and timed) in the last
+            for (const TestResults::Scope &scope: results.scopes()) {
+                if (!scope.complete) {
+                    continue;
+                }
+                m_out.append(R"({"type":"scope","testCase":)");
+                appendString(m_out, scope.testCase);
+                m_out.append(R"(,"description":)");
+                appendString(m_out, scope.description);
+                appendTiming(scope.timing);
+                appendCounters(scope.counters);
+                m_out.append("}\n");
+            }
+
+            for (const TestResults::CaseTiming &caseTiming: results.caseTimings()) {
+                m_out.append(R"({"type":"case","testCase":)");
+                appendString(m_out, caseTiming.testCase);
+                appendTiming(caseTiming.timing);
+                m_out.append("}\n");
+            }
+        }
+
+        void done() override {
+            m_out.append(R"({"type":"summary","passed":)");
+            m_out.appendNumber(m_passed);
+            m_out.append(R"(,"failed":)");
+            m_out.appendNumber(m_failed);
+            m_out.append(R"(,"errors":)");
+            m_out.appendNumber(m_errors);
+            m_out.append("}\n");
+            m_out.flush();
+            m_passed = m_failed = m_errors = 0;
+        }
+
+    private:
+        OutputBuffer m_out;
+
+        JsonReporterSettings m_settings;
+
+        uint64_t m_passed = 0, m_failed = 0, m_errors = 0;
+
+        void appendTiming(const Timing &timing) noexcept(false) {
+            m_out.append(R"(,"wallNs":)");
+            m_out.appendNumber(timing.wall.count());
+            m_out.append(R"(,"cpuNs":)");
+            m_out.appendNumber(timing.cpu.count());
+        }
+
+        void appendCounters(const CounterValues &counters) noexcept(false) {
+            auto add = [&](uint32_t event, std::string_view name, uint64_t value) {
+                if (counters.has(event)) {
+                    m_out.append(name);
+                    m_out.appendNumber(value);
+                }
+            };
+            add(PerfCounters::Cycles, R"(,"cycles":)", counters.cycles);
+            add(PerfCounters::Instructions, R"(,"instructions":)", counters.instructions);
+            add(PerfCounters::CacheMisses, R"(,"cacheMisses":)", counters.cacheMisses);
+            add(PerfCounters::BranchMisses, R"(,"branchMisses":)", counters.branchMisses);
+        }
+    };
+}
@@ -0,0 +1,282 @@
+/**
+ * C++ BBUnit - JUnit XML reporter
+ *
+ * Writes the results in the JUnit XML format, which most CI systems
+ * can display.
+ */
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "../bbunit.hpp"
+#include "output-buffer.hpp"
+
+namespace BBUnit::Utilities {
+    /**
+     * Sink which writes a JUnit XML report, with a ``testcase`` element for every
+     * ``it`` scope (named after the scope, with the test case as class name).
+     *
+     * The report is written while the tests run. The totals in the ``testsuite``
+     * element are only known at the end, so they're filled in afterward when
+     * the output is a (seekable) file not opened for appending, and left out
+     * otherwise.
+     *
+     * Write one run per reporter.
+     */
+    class JUnitReporter : public ResultSink {
+    public:
+        /**
+         * Write to a file descriptor.
+         *
+         * @param fd
+         * @param suiteName
+         */
+        explicit JUnitReporter(int fd, std::string suiteName = "BBUnit")
+                : m_out(fd), m_suiteName(std::move(suiteName)) {}
+
+        /**
+         * Write to a file.
+         *
+         * @param path
+         * @param suiteName
+         */
+        explicit JUnitReporter(const std::string &path, std::string suiteName = "BBUnit")
+                : m_out(path), m_suiteName(std::move(suiteName)) {}
+
+        /**
+         * Append text to the output, escaped for use in XML content and attributes.
+         * Control characters, which XML doesn't allow, are replaced with ``?``.
+         *
+         * @param out
+         * @param text
+         */
+        static void appendEscaped(OutputBuffer &out, std::string_view text) noexcept(false) {
+            size_t plain = 0;
+            for (size_t i = 0; i < text.size(); ++i) {
+                auto c = static_cast<unsigned char>(text[i]);
+                bool control = c < 0x20 && c != '\t' && c != '\n' && c != '\r';
+                if (!control && c != '&' && c != '<' && c != '>' && c != '"' && c != '\'') {
+                    continue;
+                }
+
+                // Copy the run of characters which don't need escaping in one go
+                out.append(text.substr(plain, i - plain));
+                plain = i + 1;
+                switch (c) {
+                    case '&':
+                        out.append("&amp;");
+                        break;
+                    case '<':
+                        out.append("&lt;");
+                        break;
+                    case '>':
+                        out.append("&gt;");
+                        break;
+                    case '"':
+                        out.append("&quot;");
+                        break;
+                    case '\'':
+                        out.append("&apos;");
+                        break;
+                    default:
+                        out.append('?');
+                }
+            }
+            out.append(text.substr(plain));
+        }
+
+    protected:
+        void consume(TestResults &&results) override {
+            if (!m_started) {
+                writeHeader();
+            }
+
+            const std::vector<TestResults::Scope> &scopes = results.scopes();
+            size_t index = 0;
+            for (size_t scope = 0; scope < scopes.size(); ++scope) {
+                // The results of a scope are stored consecutively
+                size_t from = index;
+                while (index < results.size() && results[index].scopeIndex() == scope) {
+                    ++index;
+                }
+
+                // A scope handed over in several batches is only complete (and timed)
+                // in the last, so its results are kept until then
+                if (scope + 1 == scopes.size() && !scopes[scope].complete && index > from) {
+                    m_partial.emplace_back(std::move(results), from);
+                    return;
+                }
+                writeTestCase(results, scopes[scope], from, index);
+            }
+        }
+
+        void done() override {
+            if (!m_started) {
+                writeHeader();
+            }
+
+            // A scope which was never completed, for example because the run was aborted
+            if (!m_partial.empty()) {
+                auto [results, from] = std::move(m_partial.back());
+                m_partial.pop_back();
+                writeTestCase(results, results.scopes().back(), from, results.size());
+            }
+
+            m_out.append("  </testsuite>\n</testsuites>\n");
+            m_out.flush();
+            writeTotals();
+
+            m_started = false;
+            m_tests = m_failures = m_errors = 0;
+            m_time = 0;
+        }
+
+    private:
+        /**
+         * Width reserved for the attributes of the ``testsuite`` element,
+         * so they can be filled in afterward.
+         */
+        static constexpr size_t TotalsWidth = 96;
+
+        OutputBuffer m_out;
+
+        std::string m_suiteName;
+
+        bool m_started = false;
+
+        /**
+         * Offset of the totals in the file, when it's seekable.
+         */
+        long long m_totalsOffset = -1;
+
+        uint64_t m_tests = 0, m_failures = 0, m_errors = 0;
+
+        double m_time = 0;
+
+        /**
+         * Batches ending with the incomplete part of a scope, and where in each the part begins.
+         */
+        std::vector<std::pair<TestResults, size_t>> m_partial;
+
+        void writeHeader() noexcept(false) {
+            m_started = true;
+            m_out.append("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<testsuites>\n  <testsuite name=\"");
+            appendEscaped(m_out, m_suiteName);
+            m_out.append('"');
+
+            m_totalsOffset = -1;
+#ifndef _WIN32
+            m_out.flush();
+            // Appending writes ignore the offset, so the totals can't be filled in
+            int flags = fcntl(m_out.fd(), F_GETFL);
+            off_t offset = flags >= 0 && !(flags & O_APPEND) ? lseek(m_out.fd(), 0, SEEK_CUR) : -1;
+            if (offset >= 0) {
+                m_totalsOffset = offset;
+                m_out.append(TotalsWidth, ' ');
+            }
+#endif
+            m_out.append(">\n");
+        }
+
+        /**
+         * Write a ``testcase`` element for the results in ``[from, to)``, preceded
+         * by the parts of the scope handed over in earlier batches.
+         *
+         * @param results
+         * @param scope
+         * @param from
+         * @param to
+         */
+        void writeTestCase(const TestResults &results,
+                           const TestResults::Scope &scope,
+                           size_t from,
+                           size_t to) noexcept(false) {
+            double seconds = static_cast<double>(scope.timing.wall.count()) / 1e9;
+            ++m_tests;
+            m_time += seconds;
+
+            m_out.append("    <testcase classname=\"");
+            appendEscaped(m_out, scope.testCase);
+            m_out.append("\" name=\"");
+            appendEscaped(m_out, scope.description);
+            m_out.append("\" time=\"");
+            m_out.appendNumber(seconds, 6);
+            m_out.append('"');
+
+            bool failed = false, erroneous = false, open = false;
+            auto write = [&](const TestResults &part, size_t i) {
+                ResultRef result = part[i];
+                if (result.passed() || (result.isErr() && result.errorCode() == ErrorCode::PrevAssertionFailed)) {
+                    return;
+                }
+                if (!open) {
+                    m_out.append(">\n");
+                    open = true;
+                }
+
+                if (result.isErr()) {
+                    erroneous = true;
+                    m_out.append("      <error type=\"");
+                    m_out.append(errorCodeName(result.errorCode()));
+                    m_out.append("\" message=\"");
+                    appendEscaped(m_out, result.message());
+                } else {
+                    failed = true;
+                    m_out.append("      <failure type=\"assertion\" message=\"#");
+                    m_out.appendNumber(result.caseNo());
+                    m_out.append(": Expected: ");
+                    appendEscaped(m_out, result.expected());
+                    m_out.append(", Actual: ");
+                    appendEscaped(m_out, result.actual());
+                }
+                if (!result.additional().empty()) {
+                    m_out.append(" (");
+                    appendEscaped(m_out, result.additional());
+                    m_out.append(')');
+                }
+                m_out.append("\"/>\n");
+            };
+
+            for (const auto &[part, partFrom]: m_partial) {
+                for (size_t i = partFrom; i < part.size(); ++i) {
+                    write(part, i);
+                }
+            }
+            m_partial.clear();
+            for (size_t i = from; i < to; ++i) {
+                write(results, i);
+            }
+
+            m_out.append(open ? "    </testcase>\n" : "/>\n");
+            m_errors += erroneous;
+            m_failures += failed && !erroneous;
+        }
+
+        /**
+         * Fill in the totals reserved in the ``testsuite`` element.
+         */
+        void writeTotals() noexcept(false) {
+#ifndef _WIN32
+            if (m_totalsOffset < 0) {
+                return;
+            }
+
+            std::string totals = " tests=\"" + std::to_string(m_tests)
+                                 + "\" failures=\"" + std::to_string(m_failures)
+                                 + "\" errors=\"" + std::to_string(m_errors) + "\" time=\"";
+            char seconds[32];
+            auto result = std::to_chars(seconds, seconds + sizeof(seconds), m_time, std::chars_format::fixed, 6);
+            totals.append(seconds, result.ptr);
+            totals += '"';
+            if (totals.size() <= TotalsWidth) {
+                ssize_t written = pwrite(m_out.fd(), totals.data(), totals.size(), m_totalsOffset);
+                (void) written;
+            }
+#endif
+        }
+    };
+}
@@ -0,0 +1,405 @@
+/**
+ * C++ BBUnit - Mapped file utility
+ *
+ * Read-only access to large data files, such as the tables of data-driven
+ * tests, without reading them into memory up front.
+ */
+
+#pragma once
+
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <iterator>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#ifdef _WIN32
+#include <fstream>
+#include <sstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace BBUnit::Utilities {
+    /**
+     * A file mapped into memory, read-only. Pages are loaded by the operating
+     * system as they're accessed.
+     *
+     * On Windows, the file is read into memory instead.
+     */
+    class MappedFile {
+    public:
+        /**
+         * @throws std::runtime_error When the file can't be opened or mapped.
+         * @param path
+         */
+        explicit MappedFile(const std::string &path) noexcept(false) {
+#ifdef _WIN32
+            std::ifstream file(path, std::ios::binary);
+            if (!file) {
+                throw std::runtime_error("Unable to open " + path);
+            }
+            std::ostringstream contents;
+            contents << file.rdbuf();
+            m_contents = contents.str();
+            m_bytes = m_contents;
+#else
+            int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            struct stat info{};
+            if (fd < 0 || fstat(fd, &info) != 0) {
+                int error = errno;
+                if (fd >= 0) {
+                    close(fd);
+                }
+                throw std::runtime_error("Unable to open " + path + ": " + std::strerror(error));
+            }
+
+            // Mapping an empty file fails, and isn't needed
+            if (info.st_size > 0) {
+                void *data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+                if (data == MAP_FAILED) {
+                    int error = errno;
+                    close(fd);
+                    throw std::runtime_error("Unable to map " + path + ": " + std::strerror(error));
+                }
+                madvise(data, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+                m_bytes = {static_cast<const char *>(data), static_cast<size_t>(info.st_size)};
+            }
+            close(fd);
+#endif
+        }
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        ~MappedFile() {
+#ifndef _WIN32
+            if (!m_bytes.empty()) {
+                munmap(const_cast<char *>(m_bytes.data()), m_bytes.size());
+            }
+#endif
+        }
+
+        /**
+         * The contents of the file.
+         *
+         * @return
+         */
+        [[nodiscard]] std::string_view bytes() const noexcept {
+            return m_bytes;
+        }
+
+    private:
+        std::string_view m_bytes;
+
+#ifdef _WIN32
+        std::string m_contents;
+#endif
+    };
+
+    /**
+     * A file of fixed-size binary records, such as one written from a
+     * ``std::vector<T>``, viewed as a span of ``T``.
+     *
+     * @tparam T
+     */
+    template<typename T> requires std::is_trivially_copyable_v<T>
+    class RecordFile {
+    public:
+        /**
+         * @throws std::runtime_error When the file can't be mapped, or its size isn't
+         *      a multiple of the record size.
+         * @param path
+         */
+        explicit RecordFile(const std::string &path) noexcept(false) : m_file(path) {
+            if (m_file.bytes().size() % sizeof(T) != 0) {
+                throw std::runtime_error("The size of " + path + " isn't a multiple of the record size");
+            }
+        }
+
+        /**
+         * The records. The mapping is page-aligned, so they're suitably aligned.
+         *
+         * @return
+         */
+        [[nodiscard]] std::span<const T> records() const noexcept {
+            return {reinterpret_cast<const T *>(m_file.bytes().data()), m_file.bytes().size() / sizeof(T)};
+        }
+
+        [[nodiscard]] auto begin() const noexcept {
+            return records().begin();
+        }
+
+        [[nodiscard]] auto end() const noexcept {
+            return records().end();
+        }
+
+    private:
+        MappedFile m_file;
+    };
+
+    /**
+     * CSV settings
+     */
+    struct CsvSettings {
+        char delimiter = ',';
+
+        /**
+         * When true, the first line holds the names of the columns, and
+         * isn't one of the rows.
+         */
+        bool header = true;
+    };
+
+    /**
+     * A row of a ``CsvFile``. Its fields are views into the mapped file, and
+     * only valid while iterating to the next row.
+     */
+    class CsvRow {
+    public:
+        /**
+         * Number of the row, counting from ``0`` (not counting the header).
+         *
+         * @return
+         */
+        [[nodiscard]] size_t index() const noexcept {
+            return m_index;
+        }
+
+        [[nodiscard]] size_t size() const noexcept {
+            return m_fields.size();
+        }
+
+        /**
+         * A field, or an empty string when the row is too short.
+         *
+         * @param column
+         * @return
+         */
+        [[nodiscard]] std::string_view operator[](size_t column) const noexcept {
+            return column < m_fields.size() ? m_fields[column] : std::string_view();
+        }
+
+        /**
+         * A field parsed as a number (or as a ``std::string``).
+         *
+         * @tparam T
+         * @param column
+         * @return The value, or ``std::nullopt`` when the field isn't a valid ``T``.
+         */
+        template<typename T>
+        [[nodiscard]] std::optional<T> get(size_t column) const noexcept(false) {
+            std::string_view field = (*this)[column];
+            if constexpr (std::is_same_v<T, std::string>) {
+                return std::string(field);
+            } else {
+                T value{};
+                auto result = std::from_chars(field.data(), field.data() + field.size(), value);
+                if (result.ec != std::errc() || result.ptr != field.data() + field.size()) {
+                    return std::nullopt;
+                }
+                return value;
+            }
+        }
+
+        [[nodiscard]] auto begin() const noexcept {
+            return m_fields.begin();
+        }
+
+        [[nodiscard]] auto end() const noexcept {
+            return m_fields.end();
+        }
+
+    private:
+        friend class CsvFile;
+
+        size_t m_index = 0;
+
+        /**
+         * Reused from row to row, so iterating doesn't allocate.
+         */
+        std::vector<std::string_view> m_fields;
+
+        /**
+         * Split a line into fields.
+         *
+         * @param line
+         * @param delimiter
+         */
+        void parse(std::string_view line, char delimiter) noexcept(false) {
+            if (!line.empty() && line.back() == '\r') {
+                line.remove_suffix(1);
+            }
+            m_fields.clear();
+            size_t start = 0;
+            while (true) {
+                size_t end = line.find(delimiter, start);
+                m_fields.push_back(line.substr(start, end == std::string_view::npos ? std::string_view::npos : end - start));
+                if (end == std::string_view::npos) {
+                    break;
+                }
+                start = end + 1;
+            }
+        }
+    };
+
+    /**
+     * A memory-mapped CSV file, which is parsed one row at a time while
+     * iterating, so the table is never materialized:
+     *
+     * ````cpp
+     * Utilities::CsvFile table("prices.csv");
+     * for (const Utilities::CsvRow &row: table) {
+     *     row.get<double>(table.column("price"));
+     * }
+     * ````
+     *
+     * Fields are separated by the delimiter. Quoting isn't supported, and
+     * empty lines are skipped.
+     */
+    class CsvFile {
+    public:
+        /**
+         * @throws std::runtime_error When the file can't be mapped.
+         * @param path
+         * @param settings
+         */
+        explicit CsvFile(const std::string &path, const CsvSettings &settings = {}) noexcept(false)
+                : m_file(path), m_settings(settings) {
+            m_rows = m_file.bytes();
+            if (m_settings.header) {
+                CsvRow header;
+                header.parse(nextLine(m_rows), m_settings.delimiter);
+                m_columns.assign(header.begin(), header.end());
+            }
+        }
+
+        /**
+         * Names of the columns, from the header.
+         *
+         * @return
+         */
+        [[nodiscard]] const std::vector<std::string_view> &columns() const noexcept {
+            return m_columns;
+        }
+
+        /**
+         * Index of a column, by its name in the header.
+         *
+         * @throws std::out_of_range When there's no such column.
+         * @param name
+         * @return
+         */
+        [[nodiscard]] size_t column(std::string_view name) const noexcept(false) {
+            for (size_t i = 0; i < m_columns.size(); ++i) {
+                if (m_columns[i] == name) {
+                    return i;
+                }
+            }
+            throw std::out_of_range("No column named " + std::string(name));
+        }
+
+        class Iterator {
+        public:
+            using iterator_category = std::input_iterator_tag;
+            using value_type = CsvRow;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const CsvRow *;
+            using reference = const CsvRow &;
+
+            Iterator() = default;
+
+            Iterator(std::string_view rest, char delimiter) : m_rest(rest), m_delimiter(delimiter) {
+                advance();
+            }
+
+            reference operator*() const noexcept {
+                return m_row;
+            }
+
+            pointer operator->() const noexcept {
+                return &m_row;
+            }
+
+            Iterator &operator++() noexcept(false) {
+                advance();
+                return *this;
+            }
+
+            void operator++(int) noexcept(false) {
+                advance();
+            }
+
+            bool operator==(const Iterator &other) const noexcept {
+                return m_done == other.m_done;
+            }
+
+        private:
+            std::string_view m_rest;
+
+            char m_delimiter = ',';
+
+            CsvRow m_row;
+
+            bool m_done = true;
+
+            void advance() noexcept(false) {
+                std::string_view line;
+                while (line.empty() || line == "\r") {
+                    if (m_rest.empty()) {
+                        m_done = true;
+                        return;
+                    }
+                    line = nextLine(m_rest);
+                }
+                if (!m_done) {
+                    ++m_row.m_index;
+                }
+                m_done = false;
+                m_row.parse(line, m_delimiter);
+            }
+        };
+
+        [[nodiscard]] Iterator begin() const noexcept(false) {
+            return {m_rows, m_settings.delimiter};
+        }
+
+        [[nodiscard]] Iterator end() const noexcept {
+            return {};
+        }
+
+    private:
+        MappedFile m_file;
+
+        CsvSettings m_settings;
+
+        /**
+         * The part of the file after the header.
+         */
+        std::string_view m_rows;
+
+        std::vector<std::string_view> m_columns;
+
+        /**
+         * Take the next line off ``rest``.
+         *
+         * @param rest
+         * @return
+         */
+        static std::string_view nextLine(std::string_view &rest) noexcept {
+            size_t end = rest.find('\n');
+            std::string_view line = rest.substr(0, end);
+            rest.remove_prefix(end == std::string_view::npos ? rest.size() : end + 1);
+            return line;
+        }
+    };
+}
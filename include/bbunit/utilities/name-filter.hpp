@@ -0,0 +1,122 @@
+/**
+ * C++ BBUnit - Name filter utility
+ *
+ * Selects test cases and ``it`` scopes by name, so a subset of a suite
+ * can be run.
+ */
+
+#pragma once
+
+#include <memory>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace BBUnit::Utilities {
+    /**
+     * A list of comma-separated patterns, of which a name must match at least one.
+     *
+     * Patterns are globs, where ``*`` matches any sequence of characters,
+     * and ``?`` matches a single character, and they must match the entire name.
+     * Patterns prefixed with ``re:`` are regular expressions, which only need
+     * to match part of the name.
+     *
+     * An empty filter matches everything.
+     */
+    class NameFilter {
+    public:
+        NameFilter() = default;
+
+        /**
+         * @throws std::regex_error When a regular expression is invalid.
+         * @param patterns
+         */
+        explicit NameFilter(std::string_view patterns) noexcept(false) {
+            while (!patterns.empty()) {
+                size_t comma = patterns.find(',');
+                std::string_view pattern = patterns.substr(0, comma);
+                patterns = comma == std::string_view::npos ? std::string_view() : patterns.substr(comma + 1);
+                if (pattern.empty()) {
+                    continue;
+                }
+
+                if (pattern.starts_with("re:")) {
+                    m_regexes.push_back(std::make_shared<const std::regex>(std::string(pattern.substr(3))));
+                } else {
+                    m_globs.emplace_back(pattern);
+                }
+            }
+        }
+
+        /**
+         * Whether the filter lets everything through.
+         *
+         * @return
+         */
+        [[nodiscard]] bool empty() const noexcept {
+            return m_globs.empty() && m_regexes.empty();
+        }
+
+        /**
+         * Whether the name is selected by the filter.
+         *
+         * @param name
+         * @return
+         */
+        [[nodiscard]] bool matches(std::string_view name) const noexcept(false) {
+            if (empty()) {
+                return true;
+            }
+            for (const std::string &glob: m_globs) {
+                if (matchGlob(glob, name)) {
+                    return true;
+                }
+            }
+            for (const std::shared_ptr<const std::regex> &regex: m_regexes) {
+                if (std::regex_search(name.begin(), name.end(), *regex)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /**
+         * Match a glob against the entire name.
+         *
+         * @param glob
+         * @param name
+         * @return
+         */
+        [[nodiscard]] static bool matchGlob(std::string_view glob, std::string_view name) noexcept {
+            // Greedy matching, which backtracks to the most recent ``*``
+            size_t g = 0, n = 0, starG = std::string_view::npos, starN = 0;
+            while (n < name.size()) {
+                if (g < glob.size() && glob[g] == '*') {
+                    starG = g++;
+                    starN = n;
+                } else if (g < glob.size() && (glob[g] == '?' || glob[g] == name[n])) {
+                    ++g;
+                    ++n;
+                } else if (starG != std::string_view::npos) {
+                    g = starG + 1;
+                    n = ++starN;
+                } else {
+                    return false;
+                }
+            }
+            while (g < glob.size() && glob[g] == '*') {
+                ++g;
+            }
+            return g == glob.size();
+        }
+
+    private:
+        std::vector<std::string> m_globs;
+
+        /**
+         * Compiled once, and shared by copies of the filter.
+         */
+        std::vector<std::shared_ptr<const std::regex>> m_regexes;
+    };
+}
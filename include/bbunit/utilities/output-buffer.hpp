@@ -0,0 +1,212 @@
+/**
+ * C++ BBUnit - Output buffer utility
+ *
+ * A large, reusable buffer in front of a file descriptor, used by the
+ * reporters to write their output with as few system calls as possible.
+ */
+
+#pragma once
+
+#include <cerrno>
+#include <charconv>
+#include <concepts>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include <fcntl.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace BBUnit::Utilities {
+    /**
+     * Buffered writer for a file descriptor.
+     *
+     * Output is collected in the buffer, and only written when the buffer
+     * is full, or when ``flush`` is called explicitly.
+     */
+    class OutputBuffer {
+    public:
+        /**
+         * Default size of the buffer.
+         */
+        static constexpr size_t DefaultCapacity = 1 << 20;
+
+        /**
+         * Write to a file descriptor, which remains owned by the caller.
+         *
+         * @param fd
+         * @param capacity
+         */
+        explicit OutputBuffer(int fd, size_t capacity = DefaultCapacity) : m_fd(fd), m_capacity(capacity) {
+            m_buffer.reserve(capacity);
+        }
+
+        /**
+         * Create (or truncate) a file, and write to it.
+         *
+         * @throws std::runtime_error When the file can't be opened.
+         * @param path
+         * @param capacity
+         */
+        explicit OutputBuffer(const std::string &path, size_t capacity = DefaultCapacity) : m_capacity(capacity) {
+#ifdef _WIN32
+            m_fd = _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, 0644);
+#else
+            m_fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+#endif
+            if (m_fd < 0) {
+                throw std::runtime_error("Unable to open " + path + ": " + std::strerror(errno));
+            }
+            m_owned = true;
+            m_buffer.reserve(capacity);
+        }
+
+        OutputBuffer(const OutputBuffer &) = delete;
+        OutputBuffer &operator=(const OutputBuffer &) = delete;
+
+        ~OutputBuffer() {
+            try {
+                flush();
+            } catch (...) {
+                // Nowhere left to report it
+            }
+            if (m_owned) {
+#ifdef _WIN32
+                _close(m_fd);
+#else
+                close(m_fd);
+#endif
+            }
+        }
+
+        /**
+         * The file descriptor written to.
+         *
+         * @return
+         */
+        [[nodiscard]] int fd() const noexcept {
+            return m_fd;
+        }
+
+        void append(std::string_view text) noexcept(false) {
+            if (m_buffer.size() + text.size() > m_capacity) {
+                flush();
+                if (text.size() > m_capacity) {
+                    write(text);
+                    return;
+                }
+            }
+            m_buffer.append(text);
+        }
+
+        void append(char c) noexcept(false) {
+            if (m_buffer.size() >= m_capacity) {
+                flush();
+            }
+            m_buffer.push_back(c);
+        }
+
+        /**
+         * Append ``c`` a number of times.
+         *
+         * @param count
+         * @param c
+         */
+        void append(size_t count, char c) noexcept(false) {
+            if (m_buffer.size() + count > m_capacity) {
+                flush();
+            }
+            m_buffer.append(count, c);
+        }
+
+        /**
+         * Append an integer, in decimal.
+         *
+         * @tparam T
+         * @param value
+         */
+        template<std::integral T>
+        void appendNumber(T value) noexcept(false) {
+            char digits[24];
+            auto result = std::to_chars(digits, digits + sizeof(digits), value);
+            append(std::string_view(digits, static_cast<size_t>(result.ptr - digits)));
+        }
+
+        /**
+         * Append a floating-point number with a fixed number of decimals.
+         *
+         * @param value
+         * @param decimals
+         */
+        void appendNumber(double value, int decimals) noexcept(false) {
+            char digits[64];
+            auto result = std::to_chars(digits, digits + sizeof(digits), value, std::chars_format::fixed, decimals);
+            append(std::string_view(digits, static_cast<size_t>(result.ptr - digits)));
+        }
+
+        /**
+         * Write the buffered output.
+         *
+         * @throws std::runtime_error When the write fails.
+         */
+        void flush() noexcept(false) {
+            if (m_buffer.empty()) {
+                return;
+            }
+            // Also cleared when the write fails, so it isn't retried by the destructor
+            try {
+                write(m_buffer);
+            } catch (...) {
+                m_buffer.clear();
+                throw;
+            }
+            m_buffer.clear();
+        }
+
+        /**
+         * Number of bytes waiting in the buffer.
+         *
+         * @return
+         */
+        [[nodiscard]] size_t size() const noexcept {
+            return m_buffer.size();
+        }
+
+    private:
+        int m_fd = -1;
+
+        bool m_owned = false;
+
+        size_t m_capacity;
+
+        std::string m_buffer;
+
+        /**
+         * Write directly to the file descriptor.
+         *
+         * @param bytes
+         */
+        void write(std::string_view bytes) noexcept(false) {
+            while (!bytes.empty()) {
+#ifdef _WIN32
+                int n = _write(m_fd, bytes.data(), static_cast<unsigned int>(bytes.size()));
+#else
+                ssize_t n = ::write(m_fd, bytes.data(), bytes.size());
+#endif
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (n <= 0) {
+                    throw std::runtime_error(std::string("Unable to write output: ") + std::strerror(errno));
+                }
+                bytes.remove_prefix(static_cast<size_t>(n));
+            }
+        }
+    };
+}
@@ -0,0 +1,253 @@
+/**
+ * C++ BBUnit - Performance counter utility
+ *
+ * Counts cycles, instructions, cache misses and branch misses of the
+ * current thread with the hardware performance counters, through Linux'
+ * ``perf_event_open``.
+ */
+
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace BBUnit::Utilities {
+    /**
+     * Counts of hardware events. Events the hardware (or the operating system)
+     * doesn't provide are left at zero, and aren't flagged in ``measured``.
+     */
+    struct CounterValues {
+        uint64_t cycles = 0;
+        uint64_t instructions = 0;
+        uint64_t cacheMisses = 0;
+        uint64_t branchMisses = 0;
+
+        /**
+         * Bitmask of the events which were counted, see ``PerfCounters::Event``.
+         */
+        uint32_t measured = 0;
+
+        [[nodiscard]] bool has(uint32_t event) const noexcept {
+            return (measured & event) != 0;
+        }
+
+        /**
+         * Events counted since ``start``.
+         *
+         * @param start
+         * @return
+         */
+        [[nodiscard]] CounterValues since(const CounterValues &start) const noexcept {
+            return {
+                    .cycles = cycles - start.cycles,
+                    .instructions = instructions - start.instructions,
+                    .cacheMisses = cacheMisses - start.cacheMisses,
+                    .branchMisses = branchMisses - start.branchMisses,
+                    .measured = measured & start.measured,
+            };
+        }
+    };
+
+    /**
+     * Hardware performance counters of the calling thread.
+     *
+     * The counters are opened once per thread, on first use, and count only
+     * user-space events. When they can't be opened, for example in containers
+     * or virtual machines without access to them, or on other platforms than
+     * Linux, ``available`` is false, and reads return no measured events.
+     *
+     * When more events are counted than the hardware has counters for, the
+     * kernel takes turns counting them, and the counts are scaled estimates.
+     */
+    class PerfCounters {
+    public:
+        enum Event : uint32_t {
+            Cycles = 1,
+            Instructions = 2,
+            CacheMisses = 4,
+            BranchMisses = 8,
+        };
+
+        PerfCounters(const PerfCounters &) = delete;
+        PerfCounters &operator=(const PerfCounters &) = delete;
+
+        ~PerfCounters() {
+            closeGroup();
+        }
+
+        /**
+         * The counters of the calling thread.
+         *
+         * @return
+         */
+        [[nodiscard]] static PerfCounters &forThisThread() noexcept {
+            thread_local PerfCounters counters;
+#ifdef __linux__
+            // A forked process inherits the counters of the thread which forked,
+            // which still count the events of that thread in the parent
+            if (counters.m_pid != getpid()) {
+                counters.closeGroup();
+                counters.openGroup();
+            }
+#endif
+            return counters;
+        }
+
+        /**
+         * Whether hardware counters can be used on the calling thread.
+         *
+         * @return
+         */
+        [[nodiscard]] static bool available() noexcept {
+            return forThisThread().m_measured != 0;
+        }
+
+        /**
+         * Why the counters aren't available, such as "Permission denied"
+         * or "No such file or directory", or an empty string when they are.
+         *
+         * @return
+         */
+        [[nodiscard]] static std::string unavailableReason() noexcept(false) {
+            int error = forThisThread().m_error;
+            return error == 0 ? "" : std::strerror(error);
+        }
+
+        /**
+         * Events counted on the calling thread since the counters were opened.
+         * Subtract two reads (see ``CounterValues::since``) to count the events
+         * in between.
+         *
+         * @return
+         */
+        [[nodiscard]] static CounterValues read() noexcept {
+            return forThisThread().readGroup();
+        }
+
+    private:
+        /**
+         * File descriptors of the events, in the order of ``Event``. The first
+         * is the group leader.
+         */
+        int m_fds[4] = {-1, -1, -1, -1};
+
+        /**
+         * Events which were opened.
+         */
+        uint32_t m_measured = 0;
+
+        /**
+         * Why the group leader couldn't be opened. Kept as an error number, so
+         * opening the counters never allocates.
+         */
+        int m_error = 0;
+
+#ifdef __linux__
+        /**
+         * The process which opened the counters.
+         */
+        pid_t m_pid = 0;
+#endif
+
+        PerfCounters() noexcept {
+            openGroup();
+        }
+
+        void openGroup() noexcept {
+            m_measured = 0;
+            m_error = 0;
+#ifdef __linux__
+            m_pid = getpid();
+            const uint64_t configs[4] = {
+                    PERF_COUNT_HW_CPU_CYCLES,
+                    PERF_COUNT_HW_INSTRUCTIONS,
+                    PERF_COUNT_HW_CACHE_MISSES,
+                    PERF_COUNT_HW_BRANCH_MISSES,
+            };
+            for (size_t i = 0; i < 4; ++i) {
+                perf_event_attr attr{};
+                attr.size = sizeof(attr);
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.config = configs[i];
+                attr.disabled = i == 0;
+                attr.exclude_kernel = 1;
+                attr.exclude_hv = 1;
+                attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID
+                                   | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+                auto fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, m_fds[0], PERF_FLAG_FD_CLOEXEC));
+                if (fd < 0) {
+                    if (i == 0) {
+                        m_error = errno;
+                        return;
+                    }
+                    // Other events are optional, since not all hardware has them
+                    continue;
+                }
+                m_fds[i] = fd;
+                m_measured |= 1u << i;
+            }
+            ioctl(m_fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(m_fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#else
+            m_error = ENOSYS;
+#endif
+        }
+
+        void closeGroup() noexcept {
+#ifdef __linux__
+            for (int &fd: m_fds) {
+                if (fd >= 0) {
+                    close(fd);
+                    fd = -1;
+                }
+            }
+#endif
+        }
+
+        [[nodiscard]] CounterValues readGroup() const noexcept {
+            CounterValues values;
+#ifdef __linux__
+            if (m_measured == 0) {
+                return values;
+            }
+
+            // Layout of PERF_FORMAT_GROUP: count, time enabled, time running, then value and id per event
+            uint64_t data[3 + 2 * 4] = {};
+            if (::read(m_fds[0], data, sizeof(data)) < static_cast<ssize_t>(3 * sizeof(uint64_t))) {
+                return values;
+            }
+            uint64_t count = data[0], enabled = data[1], running = data[2];
+            if (running == 0) {
+                return values;
+            }
+
+            uint64_t *fields[4] = {&values.cycles, &values.instructions, &values.cacheMisses, &values.branchMisses};
+            size_t event = 0;
+            for (uint64_t i = 0; i < count && i < 4; ++i) {
+                while (event < 4 && m_fds[event] < 0) {
+                    ++event;
+                }
+                if (event == 4) {
+                    break;
+                }
+                uint64_t value = data[3 + 2 * i];
+                *fields[event++] = running < enabled
+                                   ? static_cast<uint64_t>(static_cast<double>(value) * static_cast<double>(enabled) / static_cast<double>(running))
+                                   : value;
+            }
+            values.measured = m_measured;
+#endif
+            return values;
+        }
+    };
+}
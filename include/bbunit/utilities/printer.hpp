@@ -8,6 +8,13 @@
 #pragma once
 
 #include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string_view>
+
+#include "output-buffer.hpp"
+#include "summary.hpp"
 
 #ifdef _WIN32
 #include <windows.h>
@@ -30,10 +37,55 @@ namespace BBUnit::Utilities {
          * results.
          */
         bool silencePrevAssertionFailed = true;
+
+        /**
+         * When above zero, the summary is preceded by the slowest
+         * ``it`` scopes and test cases, up to this number of each.
+         */
+        size_t slowest = 0;
+
+        /**
+         * When above zero, and allocations are tracked (see ``BBUNIT_TRACK_ALLOCATIONS``),
+         * the summary is preceded by the ``it`` scopes which allocated the most,
+         * and those which leaked, up to this number of each. The summary also
+         * shows the allocations in total.
+         */
+        size_t allocations = 0;
+
+        /**
+         * Size of the output buffer. The output is written when the buffer
+         * is full, and at the end of the run.
+         */
+        size_t bufferSize = OutputBuffer::DefaultCapacity;
+
+        /**
+         * When used as a ``ResultSink``, the output is also written when this
+         * much time has passed since it was last written, so progress remains
+         * visible during long runs.
+         */
+        std::chrono::milliseconds flushInterval{250};
     };
 
-    class Printer {
+    /**
+    * The printer can be used directly on a set of results, using ``print``,
+    * or as a ``ResultSink``, printing results while the tests are running.
+    *
+    * The output is collected in a buffer, and written to stdout (or another
+    * file descriptor) in large chunks.
+    */
+    class Printer : public ResultSink {
     public:
+        explicit Printer(const PrinterSettings &settings = {}) : Printer(1, settings) {}
+
+        /**
+         * Print to a file descriptor, which remains owned by the caller.
+         *
+         * @param fd
+         * @param settings
+         */
+        explicit Printer(int fd, const PrinterSettings &settings = {})
+                : m_settings(settings), m_out(fd, settings.bufferSize) {}
+
         /**
         * Print the test results with the specified settings.
         *
@@ -42,44 +94,174 @@ namespace BBUnit::Utilities {
         */
         static void print(const TestResults &results,
                           const PrinterSettings &settings) {
-            // Keep track of passed, failed and erroneous assertions for the summary
-            uint16_t passed = 0, failed = 0, errors = 0;
+            Printer printer(settings);
+            printer.syncStandardOutput();
+            printer.printResults(results);
+            printer.collectTimings(results);
+            printer.collectAllocations(results);
+            printer.done();
+        }
+
+        /**
+         * Print the ``it`` scopes of the results, grouped by test case.
+         * Used with ``Settings::listOnly``.
+         *
+         * @param results
+         */
+        static void list(const TestResults &results) {
+            Printer printer;
+            printer.syncStandardOutput();
+
+            const std::string *testCase = nullptr;
+            for (const TestResults::Scope &scope: results.scopes()) {
+                if (!testCase || *testCase != scope.testCase) {
+                    testCase = &scope.testCase;
+                    printer.m_out.append(scope.testCase);
+                    printer.m_out.append('\n');
+                }
+                printer.m_out.append("  ");
+                printer.m_out.append(scope.description);
+                printer.m_out.append('\n');
+            }
+            printer.m_out.flush();
+        }
 
+    protected:
+        void consume(TestResults &&results) override {
+            syncStandardOutput();
+            printResults(results);
+            collectTimings(results);
+            collectAllocations(results);
+
+            auto now = std::chrono::steady_clock::now();
+            if (now - m_lastFlush >= m_settings.flushInterval) {
+                m_out.flush();
+                m_lastFlush = now;
+            }
+        }
+
+        /**
+        * Print the summary, and get ready for another run.
+        */
+        void done() override {
+            if (!m_started) {
+                syncStandardOutput();
+                printHeader();
+            }
+            printSlowest();
+            printAllocations();
+            printSummary();
+            m_out.flush();
+            m_counts = {};
+            m_started = false;
+            m_slowScopes.clear();
+            m_slowCases.clear();
+            m_allocations = {};
+            m_mostAllocating.clear();
+            m_leaking.clear();
+        }
+
+    private:
+        PrinterSettings m_settings;
+
+        OutputBuffer m_out;
+
+        /**
+         * When the output was last written, for ``PrinterSettings::flushInterval``.
+         */
+        std::chrono::steady_clock::time_point m_lastFlush = std::chrono::steady_clock::now();
+
+        /**
+        * Keep track of passed, failed and erroneous assertions for the summary
+        */
+        ResultCounts m_counts;
+
+        /**
+        * Whether the header has been printed for the current run.
+        */
+        bool m_started = false;
+
+        /**
+         * The slowest scopes and test cases seen so far in the current run.
+         */
+        std::vector<TestResults::Scope> m_slowScopes;
+        std::vector<TestResults::CaseTiming> m_slowCases;
+
+        /**
+         * Allocations in total, and the scopes which allocated the most and
+         * which leaked, seen so far in the current run.
+         */
+        AllocationCounts m_allocations;
+        std::vector<TestResults::Scope> m_mostAllocating;
+        std::vector<TestResults::Scope> m_leaking;
+
+        /**
+         * Write what the tests have printed through ``std::cout`` and ``stdout``,
+         * so it isn't mixed up with the buffered output.
+         */
+        static void syncStandardOutput() {
+            std::cout.flush();
+            std::fflush(stdout);
+        }
+
+        void printHeader() {
             // Shameless self-promotion...
-            std::cout << "C++ BBUnit" << std::endl;
+            m_out.append("C++ BBUnit\n");
+        }
 
-            std::for_each(results.begin(), results.end(), [&](const Result &result) {
-                if (result.isErr()) {
-                    ++errors;
+        /**
+        * Print a batch of results, and count them for the summary.
+        *
+        * @param results
+        */
+        void printResults(const TestResults &results) {
+            if (!m_started) {
+                printHeader();
+                m_started = true;
+            }
+
+            // Results are read straight from the compact storage, through ``ResultRef``
+            for (ResultRef result: results) {
+                m_counts.add(result);
 
-                    Error err = std::get<Error>(result);
+                if (result.isErr()) {
 
-                    if (settings.silencePrevAssertionFailed && err.errorCode == ErrorCode::PrevAssertionFailed) {
-                        return;
+                    if (m_settings.silencePrevAssertionFailed && result.errorCode() == ErrorCode::PrevAssertionFailed) {
+                        continue;
                     }
 
-                    if (!settings.printPassed) {
-                        std::cout << "\n";
+                    if (!m_settings.printPassed) {
+                        m_out.append('\n');
                     }
 
                     setTextFormat(Color::Red);
-                    std::cout << " ERR  ";
+                    m_out.append(" ERR  ");
                     setTextFormat(Color::Blank, true);
 
-                    std::cout << " " << err.info.description << "\n" << strRepeat(6, ' ');
-                    if (!err.info.additional.empty()) {
-                        std::cout << " - " << err.info.additional;
+                    m_out.append(' ');
+                    m_out.append(result.description());
+                    m_out.append('\n');
+                    m_out.append(6, ' ');
+                    if (!result.additional().empty()) {
+                        m_out.append(" - ");
+                        m_out.append(result.additional());
                     }
 
                     setTextFormat(Color::Blank);
 
                     // Convert the error code into a human-readable message
-                    switch (err.errorCode) {
+                    switch (result.errorCode()) {
                         case ErrorCode::PrevAssertionFailed:
-                            std::cout << " Previous case failed";
+                            m_out.append(" Previous case failed");
                             break;
                         case ErrorCode::ExceptionCaught:
-                            std::cout << " Exception caught";
+                            m_out.append(" Exception caught");
+                            break;
+                        case ErrorCode::Crashed:
+                            m_out.append(" Crashed");
+                            break;
+                        case ErrorCode::TimedOut:
+                            m_out.append(" Timed out");
                             break;
                         default:
                             // This is a message to developers of BBUnit :-)
@@ -88,81 +270,215 @@ namespace BBUnit::Utilities {
                             assert(false && "Mapping of error codes is incomplete.");
                     }
 
-                    if (!err.message.empty()) {
-                        std::cout << ": " << err.message;
-                    };
+                    if (!result.message().empty()) {
+                        m_out.append(": ");
+                        m_out.append(result.message());
+                    }
 
-                    if (!err.info.additional.empty()) {
-                        std::cout << " >> " << err.info.additional;
+                    if (!result.additional().empty()) {
+                        m_out.append(" >> ");
+                        m_out.append(result.additional());
                     }
 
-                    std::cout << std::endl;
+                    m_out.append('\n');
                 } else {
-                    auto testResult = std::get<TestResult>(result);
-
-                    if (testResult.passed) {
-                        ++passed;
-                    } else {
-                        ++failed;
-                    }
+                    bool resultPassed = result.passed();
 
                     // If we don't want to print passed assertions, we skip ahead
-                    if (testResult.passed && !settings.printPassed) {
-                        return;
+                    if (resultPassed && !m_settings.printPassed) {
+                        continue;
                     }
 
                     // If we don't print passed assertions, we add some whitespace
                     // to make it easier to read the errors.
-                    if (!settings.printPassed) {
-                        std::cout << "\n";
+                    if (!m_settings.printPassed) {
+                        m_out.append('\n');
                     }
 
                     // Box with either "PASS" or "FAIL"
-                    setTextFormat(testResult.passed ? Color::Green : Color::Red);
-                    std::cout << (testResult.passed ? " PASS " : " FAIL ");
+                    setTextFormat(resultPassed ? Color::Green : Color::Red);
+                    m_out.append(resultPassed ? " PASS " : " FAIL ");
 
                     setTextFormat(Color::Blank, true);
 
                     // Print the description and the assertion's case number (e.g. if it's the 3rd assertion
                     // in the scope)
-                    std::cout << " " << testResult.info.description << " ";
-                    std::cout << "#" << std::to_string(testResult.info.caseNo);
-
-                    if (!testResult.info.additional.empty()) {
-                        std::cout << " - " << testResult.info.additional;
+                    m_out.append(' ');
+                    m_out.append(result.description());
+                    m_out.append(" #");
+                    m_out.appendNumber(result.caseNo());
+
+                    if (!result.additional().empty()) {
+                        m_out.append(" - ");
+                        m_out.append(result.additional());
                     }
 
                     setTextFormat(Color::Blank);
 
-                    if (!testResult.passed) {
-                        printExpectedActual(testResult.expected, testResult.actual);
+                    if (!resultPassed) {
+                        printExpectedActual(result.expected(), result.actual());
                     }
 
-                    std::cout << "\n";
+                    m_out.append('\n');
                 }
-            });
+            }
+        }
+
+        /**
+         * Keep the slowest ``m_settings.slowest`` elements of ``list``.
+         *
+         * @tparam T
+         * @param list
+         */
+        template<typename T>
+        void keepSlowest(std::vector<T> &list) const {
+            auto slower = [](const T &a, const T &b) {
+                return a.timing.wall > b.timing.wall;
+            };
+            size_t keep = std::min(list.size(), m_settings.slowest);
+            std::partial_sort(list.begin(), list.begin() + static_cast<std::ptrdiff_t>(keep), list.end(), slower);
+            list.resize(keep);
+        }
+
+        /**
+         * Add the timings of a batch to the slowest scopes and test cases.
+         *
+         * @param results
+         */
+        void collectTimings(const TestResults &results) {
+            if (m_settings.slowest == 0) {
+                return;
+            }
 
-            printSummary(passed, failed, errors);
+            m_slowScopes.insert(m_slowScopes.end(), results.scopes().begin(), results.scopes().end());
+            m_slowCases.insert(m_slowCases.end(), results.caseTimings().begin(), results.caseTimings().end());
+            keepSlowest(m_slowScopes);
+            keepSlowest(m_slowCases);
+        }
+
+        /**
+         * Add the allocations of a batch to the totals, and to the scopes which
+         * allocated the most and which leaked.
+         *
+         * @param results
+         */
+        void collectAllocations(const TestResults &results) {
+            if (m_settings.allocations == 0 || !Allocations::enabled()) {
+                return;
+            }
+
+            for (const TestResults::Scope &scope: results.scopes()) {
+                const AllocationCounts &counts = scope.allocations;
+                m_allocations.allocations += counts.allocations;
+                m_allocations.bytes += counts.bytes;
+                m_allocations.leaked += counts.leaked;
+                m_allocations.leakedBytes += counts.leakedBytes;
+                if (counts.allocations > 0) {
+                    m_mostAllocating.push_back(scope);
+                }
+                if (counts.leaked > 0 && m_leaking.size() < m_settings.allocations) {
+                    m_leaking.push_back(scope);
+                }
+            }
+
+            auto more = [](const TestResults::Scope &a, const TestResults::Scope &b) {
+                return a.allocations.allocations > b.allocations.allocations;
+            };
+            size_t keep = std::min(m_mostAllocating.size(), m_settings.allocations);
+            std::partial_sort(m_mostAllocating.begin(), m_mostAllocating.begin() + static_cast<std::ptrdiff_t>(keep),
+                              m_mostAllocating.end(), more);
+            m_mostAllocating.resize(keep);
+        }
+
+        /**
+         * Print the scopes which allocated the most, and those which leaked.
+         */
+        void printAllocations() {
+            if (m_settings.allocations == 0 || !Allocations::enabled()) {
+                return;
+            }
+
+            auto table = [&](std::string_view title, const std::vector<TestResults::Scope> &scopes) {
+                m_out.append('\n');
+                m_out.append(title);
+                m_out.append('\n');
+                m_out.append(7, ' ');
+                appendPadded("Allocs", 10);
+                appendPadded("Bytes", 12);
+                appendPadded("Peak", 12);
+                appendPadded("Leaked", 10);
+                m_out.append("Test\n");
+                for (const TestResults::Scope &scope: scopes) {
+                    m_out.append(7, ' ');
+                    appendCell({}, scope.allocations.allocations, 10);
+                    appendCell({}, scope.allocations.bytes, 12);
+                    appendCell({}, scope.allocations.peakBytes, 12);
+                    appendCell({}, scope.allocations.leaked, 10);
+                    m_out.append(scope.testCase);
+                    m_out.append(": ");
+                    m_out.append(scope.description);
+                    m_out.append('\n');
+                }
+            };
+
+            table(" Most allocations", m_mostAllocating);
+            if (!m_leaking.empty()) {
+                table(" Leaks", m_leaking);
+            }
+        }
+
+        /**
+         * Print the slowest scopes and test cases, with wall-clock and CPU time.
+         */
+        void printSlowest() {
+            if (m_settings.slowest == 0) {
+                return;
+            }
+
+            auto line = [&](std::string_view testCase, std::string_view description, const Timing &timing) {
+                m_out.append(7, ' ');
+                appendPadded(BenchmarkStats::formatDuration(static_cast<double>(timing.wall.count())), 10);
+                m_out.append(" (cpu ");
+                appendPadded(BenchmarkStats::formatDuration(static_cast<double>(timing.cpu.count())) + ")", 10);
+                m_out.append(' ');
+                if (!testCase.empty() && !description.empty()) {
+                    m_out.append(testCase);
+                    m_out.append(": ");
+                }
+                m_out.append(description.empty() ? testCase : description);
+                m_out.append('\n');
+            };
+
+            m_out.append("\n Slowest tests\n");
+            for (const TestResults::Scope &scope: m_slowScopes) {
+                line(scope.testCase, scope.description, scope.timing);
+            }
+
+            m_out.append("\n Slowest test cases\n");
+            for (const TestResults::CaseTiming &testCase: m_slowCases) {
+                line(testCase.testCase, {}, testCase.timing);
+            }
         }
 
-    private:
         /**
          * Helper function to manage printing of expected and actual values.
          *
          * @param expected
          * @param actual
          */
-        static inline void printExpectedActual(const std::string &expected,
-                                               const std::string &actual) {
-            auto indent = "\n" + strRepeat(7, ' ');
+        void printExpectedActual(const std::string &expected, const std::string &actual) {
+            m_out.append('\n');
+            m_out.append(7, ' ');
+            m_out.append("Expected: ");
+            m_out.append(parseResultValue(expected));
             if (expected.length() > 12 && actual.length() > 12) {
-                std::cout << indent << "Expected: " << parseResultValue(expected);
-                std::cout << indent << "Actual  : " << parseResultValue(actual);
+                m_out.append('\n');
+                m_out.append(7, ' ');
+                m_out.append("Actual  : ");
             } else {
-                std::cout << indent;
-                std::cout << "Expected: " << parseResultValue(expected);
-                std::cout << ", Actual: " << parseResultValue(actual);
+                m_out.append(", Actual: ");
             }
+            m_out.append(parseResultValue(actual));
         }
 
         /**
@@ -171,8 +487,8 @@ namespace BBUnit::Utilities {
          * @param input
          * @return
          */
-        static inline std::string parseResultValue(const std::string& input) {
-            return input.empty() ? "<Empty>" : input;
+        static inline std::string_view parseResultValue(const std::string &input) {
+            return input.empty() ? std::string_view("<Empty>") : std::string_view(input);
         }
 
         /**
@@ -185,71 +501,78 @@ namespace BBUnit::Utilities {
         };
 
         /**
-        * Create a string that consists of X characters.
+        * Append the text, padded with ``c`` to (at least) the desired size.
         *
-        * @param len
+        * @param text
+        * @param size
         * @param c
-        * @return
         */
-        static std::string strRepeat(uint8_t len, char c) {
-            std::string s;
-            while (s.length() < len) {
-                s += c;
+        void appendPadded(std::string_view text, size_t size, char c = ' ') {
+            m_out.append(text);
+            if (text.length() < size) {
+                m_out.append(size - text.length(), c);
             }
-            return s;
         }
 
         /**
-        * Append character ``c`` until the text has the desired size.
+        * Append a summary cell such as "Passed: 12", padded to the desired size.
         *
-        * @param target
+        * @param label
+        * @param value
         * @param size
-        * @param c
-        * @return
         */
-        static std::string pad(const std::string &target, uint8_t size, char c = ' ') {
-            if (target.length() > size) {
-                return target.substr(0, size);
+        void appendCell(std::string_view label, uint64_t value, size_t size) {
+            char cell[48];
+            size_t length = std::min(label.size(), sizeof(cell) - 20);
+            if (length > 0) {
+                std::memcpy(cell, label.data(), length);
             }
-            return target + strRepeat(size - target.length(), c);
+            auto result = std::to_chars(cell + length, cell + sizeof(cell), value);
+            appendPadded(std::string_view(cell, static_cast<size_t>(result.ptr - cell)), size);
         }
 
         /**
         * Print the summarized results.
-        *
-        * @param passed
-        * @param failed
-        * @param errors
         */
-        static void printSummary(uint16_t passed, uint16_t failed, uint16_t errors) {
+        void printSummary() {
             // Max. size of cells, such as "Total: X".
             // Just to pad spacing for nice and aligned look in the summary.
-            uint8_t cellSize = 14;
+            size_t cellSize = 14;
+            bool failed = !m_counts.ok();
 
             // Divider
-            std::cout << "\n" + strRepeat(cellSize * 4 + 16, '-') + "\n";
+            m_out.append('\n');
+            m_out.append(cellSize * 4 + 16, '-');
+            m_out.append('\n');
 
             // Print a green or red indicator for whether there were any failed tests
-            if (!failed && !errors) {
-                setTextFormat(Color::Green);
-                std::cout << " NICE ";
-            } else {
-                setTextFormat(Color::Red);
-                std::cout << " FAIL ";
-            }
+            setTextFormat(failed ? Color::Red : Color::Green);
+            m_out.append(failed ? " FAIL " : " NICE ");
 
             setTextFormat(Color::Blank);
 
-            if (!failed && !errors) {
-                std::cout << " Assertions passed: " << std::to_string(passed);
+            if (!failed) {
+                m_out.append(" Assertions passed: ");
+                m_out.appendNumber(m_counts.passed);
             } else {
-                std::cout << " " << pad("Total: " + std::to_string(passed + failed + errors), cellSize);
-                std::cout << " | " << pad("Passed: " + std::to_string(passed), cellSize);
-                std::cout << " | " << pad("Failed: " + std::to_string(failed), cellSize);
-                std::cout << " | " << pad("Errors: " + std::to_string(errors), cellSize);
+                m_out.append(' ');
+                appendCell("Total: ", m_counts.total(), cellSize);
+                m_out.append(" | ");
+                appendCell("Passed: ", m_counts.passed, cellSize);
+                m_out.append(" | ");
+                appendCell("Failed: ", m_counts.failed, cellSize);
+                m_out.append(" | ");
+                appendCell("Errors: ", m_counts.errors, cellSize);
             }
 
-            std::cout.flush();
+            if (m_settings.allocations > 0 && Allocations::enabled()) {
+                m_out.append("\n       ");
+                appendCell("Allocations: ", m_allocations.allocations, cellSize + 6);
+                m_out.append(" | ");
+                appendCell("Bytes: ", m_allocations.bytes, cellSize + 6);
+                m_out.append(" | ");
+                appendCell("Leaked: ", m_allocations.leaked, cellSize);
+            }
         }
 
         /**
@@ -260,7 +583,7 @@ namespace BBUnit::Utilities {
         *
         * @param color
         */
-        void static setTextFormat(Color color, bool bold = false) {
+        void setTextFormat(Color color, bool bold = false) {
 #ifdef _WIN32
             WORD attr;
             switch (color) {
@@ -273,7 +596,13 @@ namespace BBUnit::Utilities {
                 default:
                     attr = bold ? 0x000F : 0x0007;
             }
+
+            // The console attribute applies to what's written from now on
+            m_out.flush();
             SetConsoleTextAttribute(GetStdHandle(STD_OUTPUT_HANDLE), attr);
+#else
+            (void) color;
+            (void) bold;
 #endif
         }
     };
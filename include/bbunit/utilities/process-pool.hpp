@@ -0,0 +1,469 @@
+/**
+ * C++ BBUnit - Process pool utility
+ *
+ * A pool of pre-forked worker processes, used to isolate test cases
+ * from each other, so a crash or hang only takes down one of them.
+ *
+ * Only available on POSIX platforms, where ``BBUNIT_HAS_PROCESS_POOL``
+ * is defined.
+ */
+
+#pragma once
+
+#if defined(__unix__) || defined(__APPLE__)
+
+#define BBUNIT_HAS_PROCESS_POOL 1
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace BBUnit::Utilities {
+    /**
+     * Pool of worker processes.
+     *
+     * The workers are forked once, when ``run`` is called, and each of them
+     * works through one job after the other, so the cost of forking is paid
+     * per worker rather than per job. A worker which crashes, or exceeds the
+     * timeout, is replaced by a fresh one.
+     *
+     * Jobs send messages to the parent, which are delivered in the order they
+     * were sent. Messages sent by a job before it crashed are not lost.
+     *
+     * @note The workers are forked from the calling process, so other threads
+     *      in it shouldn't be holding locks the jobs need, while ``run`` is called.
+     */
+    class ProcessPool {
+    public:
+        enum class Status {
+            /**
+             * The job returned normally.
+             */
+            Completed,
+
+            /**
+             * The worker died (signal, or exit) while running the job.
+             */
+            Crashed,
+
+            /**
+             * The job exceeded the timeout, and the worker was killed.
+             */
+            TimedOut,
+
+            /**
+             * The job was running when the pool was cancelled, and the worker was killed.
+             */
+            Cancelled,
+        };
+
+        /**
+         * How a job ended, with a human-readable reason when it didn't complete.
+         */
+        struct Outcome {
+            Status status = Status::Completed;
+            std::string reason;
+
+            /**
+             * Time from handing the job to the worker, until it ended (or the worker died).
+             */
+            std::chrono::nanoseconds elapsed{0};
+        };
+
+        /**
+         * Used by a job (in the worker process) to send a message to the parent.
+         */
+        using Send = std::function<void(std::string_view)>;
+
+        /**
+         * Create a pool.
+         *
+         * @param workers Number of worker processes. When ``0``, the hardware concurrency is used.
+         * @param timeout Max. duration of a single job. When ``0``, jobs can run indefinitely.
+         */
+        explicit ProcessPool(unsigned int workers = 0,
+                             std::chrono::milliseconds timeout = std::chrono::milliseconds(0)) : m_timeout(timeout) {
+            m_size = workers ? workers : std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        ProcessPool(const ProcessPool &) = delete;
+        ProcessPool &operator=(const ProcessPool &) = delete;
+
+        /**
+         * Run ``job`` for every index in ``[0, count)`` in the worker processes,
+         * and block until all jobs have ended.
+         *
+         * ``receive`` and ``finished`` are called in the calling process,
+         * and never concurrently. They can call ``cancel`` to stop early, in which
+         * case jobs which haven't started are never run.
+         *
+         * @param count
+         * @param job Called in a worker process, with the index and a ``Send`` function.
+         * @param receive Called with the index and the message, for every message sent by a job.
+         * @param finished Called with the index and the outcome, when a job has ended.
+         */
+        void run(size_t count,
+                 const std::function<void(size_t, const Send &)> &job,
+                 const std::function<void(size_t, std::string &&)> &receive,
+                 const std::function<void(size_t, const Outcome &)> &finished) noexcept(false) {
+            if (count == 0) {
+                return;
+            }
+
+            m_workers.clear();
+            m_workers.resize(std::min<size_t>(m_size, count));
+            m_cancelled = false;
+            size_t next = 0;
+
+            auto assign = [&](Worker &worker) {
+                if (next >= count || m_cancelled) {
+                    return;
+                }
+                if (worker.pid <= 0) {
+                    spawn(worker, job);
+                }
+                worker.index = next++;
+                worker.started = std::chrono::steady_clock::now();
+                worker.deadline = worker.started + m_timeout;
+                auto index = static_cast<uint64_t>(*worker.index);
+                writeAll(worker.taskFd, &index, sizeof(index));
+            };
+
+            // Called when the worker died or was killed. It's replaced lazily,
+            // when (and if) there's more work.
+            auto bury = [&](Worker &worker, Status status, std::string reason) {
+                int exitStatus = 0;
+                waitpid(worker.pid, &exitStatus, 0);
+                if (status == Status::Crashed) {
+                    reason = describe(exitStatus);
+                }
+                size_t index = *worker.index;
+                auto elapsed = std::chrono::steady_clock::now() - worker.started;
+                close(worker);
+                finished(index, {status, std::move(reason), elapsed});
+                assign(worker);
+            };
+
+            // All workers are kept busy, until there's no more work (or we've been cancelled)
+            auto busy = [&]() {
+                return std::any_of(m_workers.begin(), m_workers.end(), [](const Worker &worker) {
+                    return worker.index.has_value();
+                });
+            };
+
+            try {
+                for (Worker &worker: m_workers) {
+                    assign(worker);
+                }
+
+                std::vector<pollfd> fds;
+                std::vector<Worker *> polled;
+                while (busy()) {
+                    fds.clear();
+                    polled.clear();
+                    auto now = std::chrono::steady_clock::now();
+                    int waitMs = -1;
+                    for (Worker &worker: m_workers) {
+                        if (!worker.index) {
+                            continue;
+                        }
+                        fds.push_back({worker.resultFd, POLLIN, 0});
+                        polled.push_back(&worker);
+                        if (m_timeout.count() > 0) {
+                            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(worker.deadline - now).count();
+                            int leftMs = static_cast<int>(std::clamp<long long>(left + 1, 0, INT32_MAX));
+                            waitMs = waitMs < 0 ? leftMs : std::min(waitMs, leftMs);
+                        }
+                    }
+
+                    if (poll(fds.data(), fds.size(), waitMs) < 0 && errno != EINTR) {
+                        throw std::runtime_error(std::string("poll failed: ") + std::strerror(errno));
+                    }
+
+                    for (size_t i = 0; i < fds.size(); ++i) {
+                        Worker &worker = *polled[i];
+                        if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) {
+                            continue;
+                        }
+
+                        char buffer[65536];
+                        ssize_t n = read(worker.resultFd, buffer, sizeof(buffer));
+                        if (n < 0 && errno == EINTR) {
+                            continue;
+                        }
+                        if (n <= 0) {
+                            bury(worker, Status::Crashed, {});
+                            continue;
+                        }
+
+                        worker.buffer.append(buffer, static_cast<size_t>(n));
+                        while (worker.index && worker.buffer.size() >= sizeof(uint32_t)) {
+                            uint32_t length;
+                            std::memcpy(&length, worker.buffer.data(), sizeof(length));
+                            if (length == EndOfJob) {
+                                worker.buffer.erase(0, sizeof(length));
+                                size_t index = *worker.index;
+                                worker.index.reset();
+                                finished(index, {.elapsed = std::chrono::steady_clock::now() - worker.started});
+                                assign(worker);
+                                continue;
+                            }
+                            if (worker.buffer.size() < sizeof(length) + length) {
+                                break;
+                            }
+                            receive(*worker.index, worker.buffer.substr(sizeof(length), length));
+                            worker.buffer.erase(0, sizeof(length) + length);
+                        }
+                    }
+
+                    if (m_cancelled) {
+                        for (Worker &worker: m_workers) {
+                            if (worker.index) {
+                                kill(worker.pid, SIGKILL);
+                                bury(worker, Status::Cancelled, "Cancelled");
+                            }
+                        }
+                    }
+
+                    if (m_timeout.count() > 0) {
+                        now = std::chrono::steady_clock::now();
+                        for (Worker &worker: m_workers) {
+                            if (worker.index && now >= worker.deadline) {
+                                kill(worker.pid, SIGKILL);
+                                bury(worker, Status::TimedOut,
+                                     "Exceeded the timeout of " + std::to_string(m_timeout.count()) + " ms");
+                            }
+                        }
+                    }
+                }
+            } catch (...) {
+                shutdown(true);
+                throw;
+            }
+
+            shutdown(false);
+        }
+
+        /**
+         * Stop handing out jobs, and kill the workers running one.
+         * Only to be called from the callbacks of ``run``.
+         */
+        void cancel() noexcept {
+            m_cancelled = true;
+        }
+
+    private:
+        /**
+         * Message length which marks the end of a job.
+         */
+        static constexpr uint32_t EndOfJob = UINT32_MAX;
+
+        struct Worker {
+            pid_t pid = -1;
+
+            /**
+             * Parent's ends of the pipes: indices are written to ``taskFd``,
+             * and messages are read from ``resultFd``.
+             */
+            int taskFd = -1, resultFd = -1;
+
+            /**
+             * The job the worker is running, if any.
+             */
+            std::optional<size_t> index;
+
+            std::chrono::steady_clock::time_point started, deadline;
+
+            /**
+             * Received bytes which don't yet form a complete message.
+             */
+            std::string buffer;
+        };
+
+        unsigned int m_size = 1;
+
+        std::chrono::milliseconds m_timeout;
+
+        std::vector<Worker> m_workers;
+
+        bool m_cancelled = false;
+
+        static void writeAll(int fd, const void *data, size_t size) noexcept(false) {
+            auto bytes = static_cast<const char *>(data);
+            while (size > 0) {
+                ssize_t n = write(fd, bytes, size);
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (n <= 0) {
+                    throw std::runtime_error(std::string("write failed: ") + std::strerror(errno));
+                }
+                bytes += n;
+                size -= static_cast<size_t>(n);
+            }
+        }
+
+        static bool readAll(int fd, void *data, size_t size) noexcept {
+            auto bytes = static_cast<char *>(data);
+            while (size > 0) {
+                ssize_t n = read(fd, bytes, size);
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (n <= 0) {
+                    return false;
+                }
+                bytes += n;
+                size -= static_cast<size_t>(n);
+            }
+            return true;
+        }
+
+        /**
+         * Fork a worker, which runs jobs until its task pipe is closed.
+         *
+         * @param worker
+         * @param job
+         */
+        void spawn(Worker &worker, const std::function<void(size_t, const Send &)> &job) noexcept(false) {
+            int task[2], result[2];
+            if (pipe(task) != 0) {
+                throw std::runtime_error(std::string("pipe failed: ") + std::strerror(errno));
+            }
+            if (pipe(result) != 0) {
+                ::close(task[0]);
+                ::close(task[1]);
+                throw std::runtime_error(std::string("pipe failed: ") + std::strerror(errno));
+            }
+
+            // Buffered output would otherwise be written by both processes
+            std::cout.flush();
+            std::fflush(nullptr);
+
+            pid_t pid = fork();
+            if (pid < 0) {
+                for (int fd: {task[0], task[1], result[0], result[1]}) {
+                    ::close(fd);
+                }
+                throw std::runtime_error(std::string("fork failed: ") + std::strerror(errno));
+            }
+
+            if (pid == 0) {
+                // The other workers must see end-of-file when the parent closes
+                // their pipes, so we can't hold on to the parent's ends.
+                for (Worker &other: m_workers) {
+                    if (other.pid > 0) {
+                        ::close(other.taskFd);
+                        ::close(other.resultFd);
+                    }
+                }
+                ::close(task[1]);
+                ::close(result[0]);
+                workerLoop(task[0], result[1], job);
+            }
+
+            ::close(task[0]);
+            ::close(result[1]);
+            worker.pid = pid;
+            worker.taskFd = task[1];
+            worker.resultFd = result[0];
+            worker.buffer.clear();
+        }
+
+        [[noreturn]] static void workerLoop(int taskFd,
+                                            int resultFd,
+                                            const std::function<void(size_t, const Send &)> &job) noexcept {
+            Send send = [resultFd](std::string_view message) {
+                auto length = static_cast<uint32_t>(message.size());
+                writeAll(resultFd, &length, sizeof(length));
+                writeAll(resultFd, message.data(), message.size());
+            };
+
+            uint64_t index;
+            int exitCode = 0;
+            while (readAll(taskFd, &index, sizeof(index))) {
+                try {
+                    job(static_cast<size_t>(index), send);
+                    std::cout.flush();
+                    std::fflush(nullptr);
+                    uint32_t end = EndOfJob;
+                    writeAll(resultFd, &end, sizeof(end));
+                } catch (...) {
+                    // Reported to the parent as a crash
+                    exitCode = 1;
+                    break;
+                }
+            }
+
+            // Skip static destructors and ``atexit`` handlers, which belong to the parent
+            _exit(exitCode);
+        }
+
+        /**
+         * Close the parent's ends of a worker's pipes.
+         *
+         * @param worker
+         */
+        static void close(Worker &worker) noexcept {
+            ::close(worker.taskFd);
+            ::close(worker.resultFd);
+            worker = Worker{};
+        }
+
+        /**
+         * Stop all workers, and wait for them to exit.
+         *
+         * @param force Kill them, instead of letting them finish.
+         */
+        void shutdown(bool force) noexcept {
+            for (Worker &worker: m_workers) {
+                if (worker.pid <= 0) {
+                    continue;
+                }
+                if (force) {
+                    kill(worker.pid, SIGKILL);
+                }
+                ::close(worker.taskFd);
+                waitpid(worker.pid, nullptr, 0);
+                ::close(worker.resultFd);
+            }
+            m_workers.clear();
+        }
+
+        /**
+         * Describe why a process ended, based on its ``waitpid`` status.
+         *
+         * @param status
+         * @return
+         */
+        static std::string describe(int status) noexcept(false) {
+            if (WIFSIGNALED(status)) {
+                int signal = WTERMSIG(status);
+                const char *name = strsignal(signal);
+                return "Terminated by signal " + std::to_string(signal) + (name ? std::string(" (") + name + ")" : "");
+            }
+            if (WIFEXITED(status)) {
+                return "Exited with status " + std::to_string(WEXITSTATUS(status));
+            }
+            return "Terminated";
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,128 @@
+/**
+ * C++ BBUnit - Regular expression cache
+ *
+ * Compiling a ``std::regex`` is expensive, and test suites tend to
+ * assert the same patterns over and over. This cache compiles each
+ * pattern once, and shares it between test cases and threads.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <regex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+namespace BBUnit::Utilities {
+    /**
+     * Thread-safe cache of compiled regular expressions, keyed
+     * by pattern and flags.
+     */
+    class RegexCache {
+    public:
+        /**
+         * The cache shared by the whole process, which is the default
+         * of ``Settings::regexCache``.
+         *
+         * @return
+         */
+        [[nodiscard]] static const std::shared_ptr<RegexCache> &shared() noexcept(false) {
+            static const std::shared_ptr<RegexCache> cache = std::make_shared<RegexCache>();
+            return cache;
+        }
+
+        /**
+         * Retrieve the compiled version of a pattern, compiling it
+         * if it hasn't been seen before.
+         *
+         * @throws std::regex_error When the pattern is invalid.
+         *
+         * @param pattern
+         * @param flags
+         * @return
+         */
+        [[nodiscard]] std::shared_ptr<const std::regex> get(const std::string &pattern,
+                                                             std::regex::flag_type flags = std::regex::ECMAScript) noexcept(false) {
+            Key key{pattern, flags};
+
+            {
+                std::shared_lock<std::shared_mutex> lock(m_mutex);
+                auto found = m_patterns.find(key);
+                if (found != m_patterns.end()) {
+                    ++m_hits;
+                    return found->second;
+                }
+            }
+
+            // Compile outside the lock, so other threads aren't held up.
+            // If another thread compiled the same pattern in the meantime,
+            // we use theirs.
+            auto compiled = std::make_shared<const std::regex>(pattern, flags);
+            ++m_misses;
+
+            std::unique_lock<std::shared_mutex> lock(m_mutex);
+            return m_patterns.try_emplace(std::move(key), std::move(compiled)).first->second;
+        }
+
+        /**
+         * Number of look-ups which found an already compiled pattern.
+         *
+         * @return
+         */
+        [[nodiscard]] size_t hits() const noexcept {
+            return m_hits.load();
+        }
+
+        /**
+         * Number of look-ups which had to compile the pattern.
+         *
+         * @return
+         */
+        [[nodiscard]] size_t misses() const noexcept {
+            return m_misses.load();
+        }
+
+        /**
+         * Number of compiled patterns in the cache.
+         *
+         * @return
+         */
+        [[nodiscard]] size_t size() const noexcept {
+            std::shared_lock<std::shared_mutex> lock(m_mutex);
+            return m_patterns.size();
+        }
+
+        /**
+         * Remove all compiled patterns, and reset the counters.
+         */
+        void clear() noexcept {
+            std::unique_lock<std::shared_mutex> lock(m_mutex);
+            m_patterns.clear();
+            m_hits = 0;
+            m_misses = 0;
+        }
+
+    private:
+        struct Key {
+            std::string pattern;
+            std::regex::flag_type flags;
+
+            bool operator==(const Key &other) const = default;
+        };
+
+        struct KeyHash {
+            size_t operator()(const Key &key) const noexcept {
+                return std::hash<std::string>()(key.pattern) ^ (static_cast<size_t>(key.flags) * 0x9E3779B97F4A7C15ull);
+            }
+        };
+
+        mutable std::shared_mutex m_mutex;
+
+        std::unordered_map<Key, std::shared_ptr<const std::regex>, KeyHash> m_patterns;
+
+        std::atomic<size_t> m_hits = 0, m_misses = 0;
+    };
+}
@@ -0,0 +1,128 @@
+/**
+ * C++ BBUnit - Results database utility
+ *
+ * Remembers the outcome of each test case across runs, so a run can be
+ * limited to the test cases which failed, or which have changed.
+ */
+
+#pragma once
+
+#include <charconv>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace BBUnit::Utilities {
+    /**
+     * Outcome of the most recent run of each test case.
+     *
+     * The file consists of lines on the form
+     * ``<0 or 1 for failed><tab><duration in ns><tab><version><tab><test case name>``.
+     */
+    class ResultsDatabase {
+    public:
+        /**
+         * The outcome of a test case.
+         */
+        struct Entry {
+            /**
+             * Whether an assertion failed, or caused an error.
+             */
+            bool failed = false;
+
+            std::chrono::nanoseconds duration{0};
+
+            /**
+             * The version of the test case (see ``TestCase::version``) which ran.
+             */
+            std::string version;
+        };
+
+        ResultsDatabase() = default;
+
+        /**
+         * Load the database from a file. A missing file is treated as
+         * an empty database, and malformed lines are skipped.
+         *
+         * @param path
+         */
+        explicit ResultsDatabase(std::string path) : m_path(std::move(path)) {
+            std::ifstream file(m_path);
+            std::string line;
+            while (std::getline(file, line)) {
+                size_t first = line.find('\t');
+                size_t second = first == std::string::npos ? first : line.find('\t', first + 1);
+                size_t third = second == std::string::npos ? second : line.find('\t', second + 1);
+                if (third == std::string::npos) {
+                    continue;
+                }
+
+                std::string_view failed(line.data(), first);
+                const char *from = line.data() + first + 1, *to = line.data() + second;
+                std::chrono::nanoseconds::rep duration = 0;
+                auto [end, error] = std::from_chars(from, to, duration);
+                if ((failed != "0" && failed != "1") || error != std::errc() || end != to) {
+                    continue;
+                }
+                m_entries[line.substr(third + 1)] = {
+                        .failed = failed == "1",
+                        .duration = std::chrono::nanoseconds(duration),
+                        .version = line.substr(second + 1, third - second - 1),
+                };
+            }
+        }
+
+        /**
+         * Look up the most recent outcome of a test case.
+         *
+         * @param testCase
+         * @return
+         */
+        [[nodiscard]] std::optional<Entry> find(const std::string &testCase) const noexcept(false) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto found = m_entries.find(testCase);
+            if (found == m_entries.end()) {
+                return std::nullopt;
+            }
+            return found->second;
+        }
+
+        /**
+         * Record the outcome of a test case.
+         *
+         * @param testCase
+         * @param entry
+         */
+        void record(const std::string &testCase, Entry entry) noexcept(false) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_entries[testCase] = std::move(entry);
+        }
+
+        /**
+         * Write the database to the file it was loaded from.
+         * Nothing happens, when there's no file.
+         */
+        void save() const noexcept(false) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_path.empty()) {
+                return;
+            }
+            std::ofstream file(m_path);
+            for (const auto &[testCase, entry]: m_entries) {
+                file << (entry.failed ? '1' : '0') << '\t' << entry.duration.count() << '\t'
+                     << entry.version << '\t' << testCase << '\n';
+            }
+        }
+
+    private:
+        std::string m_path;
+
+        mutable std::mutex m_mutex;
+
+        std::map<std::string, Entry> m_entries;
+    };
+}
@@ -0,0 +1,169 @@
+/**
+ * C++ BBUnit - Sharding utility
+ *
+ * Splits a suite into disjoint shards, for example to spread it across
+ * a number of CI machines, balanced by the durations of a previous run.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace BBUnit::Utilities {
+    /**
+     * Durations of test cases, recorded by the ``TestRunner``, and used
+     * to balance the shards of the next run.
+     *
+     * The file consists of lines on the form ``<duration in ns><tab><test case name>``.
+     *
+     * Durations are keyed by ``TestCase::name``, so instances of the same class
+     * share an entry, holding the duration of whichever ran last. Override
+     * ``name`` to tell them apart.
+     */
+    class CaseDurations {
+    public:
+        CaseDurations() = default;
+
+        /**
+         * Load the durations from a file. A missing file is treated as
+         * if no durations have been recorded yet, and malformed lines are skipped.
+         *
+         * @param path
+         */
+        explicit CaseDurations(std::string path) : m_path(std::move(path)) {
+            std::ifstream file(m_path);
+            std::string line;
+            while (std::getline(file, line)) {
+                size_t tab = line.find('\t');
+                if (tab == std::string::npos) {
+                    continue;
+                }
+                std::chrono::nanoseconds::rep duration = 0;
+                auto [end, error] = std::from_chars(line.data(), line.data() + tab, duration);
+                if (error != std::errc() || end != line.data() + tab) {
+                    continue;
+                }
+                m_durations[line.substr(tab + 1)] = std::chrono::nanoseconds(duration);
+            }
+        }
+
+        /**
+         * Look up the recorded duration of a test case.
+         *
+         * @param testCase
+         * @return
+         */
+        [[nodiscard]] std::optional<std::chrono::nanoseconds> find(const std::string &testCase) const noexcept(false) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto found = m_durations.find(testCase);
+            if (found == m_durations.end()) {
+                return std::nullopt;
+            }
+            return found->second;
+        }
+
+        /**
+         * Record the duration of a test case.
+         *
+         * @param testCase
+         * @param duration
+         */
+        void set(const std::string &testCase, std::chrono::nanoseconds duration) noexcept(false) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_durations[testCase] = duration;
+        }
+
+        /**
+         * Write the durations to the file they were loaded from.
+         * Nothing happens, when there's no file.
+         */
+        void save() const noexcept(false) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_path.empty()) {
+                return;
+            }
+            std::ofstream file(m_path);
+            for (const auto &[testCase, duration]: m_durations) {
+                file << duration.count() << '\t' << testCase << '\n';
+            }
+        }
+
+    private:
+        std::string m_path;
+
+        mutable std::mutex m_mutex;
+
+        std::map<std::string, std::chrono::nanoseconds> m_durations;
+    };
+
+    /**
+     * Deterministic partitioning of work into shards.
+     */
+    class Sharding {
+    public:
+        /**
+         * Assign each item to one of ``shards`` shards, so the expected
+         * duration of the shards is as even as possible.
+         *
+         * The longest items are assigned first, each to the shard with
+         * the least work so far (ties go to the lowest shard, and equal items
+         * are taken in order). The result only depends on the input, so every
+         * machine computes the same assignment.
+         *
+         * Items without a known duration are expected to take the (lower) median
+         * of the known durations.
+         *
+         * @param durations Expected duration of each item.
+         * @param shards
+         * @return The shard of each item.
+         */
+        [[nodiscard]] static std::vector<unsigned int> assign(const std::vector<std::optional<std::chrono::nanoseconds>> &durations,
+                                                              unsigned int shards) noexcept(false) {
+            std::vector<unsigned int> assigned(durations.size(), 0);
+            if (shards <= 1) {
+                return assigned;
+            }
+
+            std::vector<std::chrono::nanoseconds> known;
+            for (const auto &duration: durations) {
+                if (duration) {
+                    known.push_back(*duration);
+                }
+            }
+            std::chrono::nanoseconds fallback(1);
+            if (!known.empty()) {
+                size_t median = (known.size() - 1) / 2;
+                std::nth_element(known.begin(), known.begin() + static_cast<std::ptrdiff_t>(median), known.end());
+                fallback = std::max(known[median], fallback);
+            }
+
+            auto expected = [&](size_t i) {
+                return durations[i].value_or(fallback);
+            };
+
+            std::vector<size_t> order(durations.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+                return expected(a) > expected(b);
+            });
+
+            std::vector<std::chrono::nanoseconds> load(shards, std::chrono::nanoseconds(0));
+            for (size_t i: order) {
+                auto lightest = static_cast<unsigned int>(std::min_element(load.begin(), load.end()) - load.begin());
+                assigned[i] = lightest;
+                load[lightest] += expected(i);
+            }
+
+            return assigned;
+        }
+    };
+}
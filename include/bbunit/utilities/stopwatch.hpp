@@ -0,0 +1,75 @@
+/**
+ * C++ BBUnit - Stopwatch utility
+ *
+ * Measures elapsed wall-clock time, as well as the CPU time
+ * spent by the current thread.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <ctime>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace BBUnit::Utilities {
+    /**
+     * Stopwatch which starts when it's created.
+     */
+    class Stopwatch {
+    public:
+        Stopwatch() noexcept : m_wallStart(std::chrono::steady_clock::now()), m_cpuStart(threadCpuTime()) {}
+
+        /**
+         * Wall-clock time elapsed since the stopwatch was started.
+         *
+         * @return
+         */
+        [[nodiscard]] std::chrono::nanoseconds wall() const noexcept {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_wallStart);
+        }
+
+        /**
+         * CPU time spent by the current thread since the stopwatch was started.
+         *
+         * @note Where per-thread CPU time isn't available, the CPU time of
+         *      the whole process is used instead.
+         *
+         * @return
+         */
+        [[nodiscard]] std::chrono::nanoseconds cpu() const noexcept {
+            return threadCpuTime() - m_cpuStart;
+        }
+
+        /**
+         * CPU time spent by the current thread (since an unspecified point in time).
+         *
+         * @return
+         */
+        [[nodiscard]] static std::chrono::nanoseconds threadCpuTime() noexcept {
+#if defined(_WIN32)
+            FILETIME creation, exit, kernel, user;
+            if (GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) {
+                auto ticks = [](const FILETIME &time) {
+                    return (static_cast<unsigned long long>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+                };
+                // FILETIME counts in units of 100 ns
+                return std::chrono::nanoseconds((ticks(kernel) + ticks(user)) * 100);
+            }
+#elif defined(CLOCK_THREAD_CPUTIME_ID)
+            timespec time{};
+            if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) == 0) {
+                return std::chrono::seconds(time.tv_sec) + std::chrono::nanoseconds(time.tv_nsec);
+            }
+#endif
+            return std::chrono::nanoseconds(static_cast<long long>(std::clock() * (1e9 / CLOCKS_PER_SEC)));
+        }
+
+    private:
+        std::chrono::steady_clock::time_point m_wallStart;
+
+        std::chrono::nanoseconds m_cpuStart;
+    };
+}
@@ -0,0 +1,219 @@
+/**
+ * C++ BBUnit - Summary utility
+ *
+ * Counts passed, failed and erroneous assertions in total, per test case
+ * and per ``it`` scope, as the results come in.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../bbunit.hpp"
+
+namespace BBUnit::Utilities {
+    /**
+     * Number of passed, failed and erroneous assertions.
+     */
+    struct ResultCounts {
+        uint64_t passed = 0;
+        uint64_t failed = 0;
+        uint64_t errors = 0;
+
+        [[nodiscard]] uint64_t total() const noexcept {
+            return passed + failed + errors;
+        }
+
+        /**
+         * True, when nothing failed or went wrong.
+         *
+         * @return
+         */
+        [[nodiscard]] bool ok() const noexcept {
+            return failed == 0 && errors == 0;
+        }
+
+        void add(ResultRef result) noexcept {
+            if (result.isErr()) {
+                ++errors;
+            } else if (result.passed()) {
+                ++passed;
+            } else {
+                ++failed;
+            }
+        }
+
+        ResultCounts &operator+=(const ResultCounts &other) noexcept {
+            passed += other.passed;
+            failed += other.failed;
+            errors += other.errors;
+            return *this;
+        }
+    };
+
+    /**
+     * Counts of results, in total, per test case and per ``it`` scope.
+     *
+     * Results can be added in any number of batches. A scope handed over
+     * in several batches (see ``Settings::sinkBatchSize``) is counted as one.
+     * Scopes with the same description in the same test case are counted
+     * together.
+     */
+    class ResultSummary {
+    public:
+        struct CaseCounts {
+            std::string testCase;
+            ResultCounts counts;
+        };
+
+        struct ScopeCounts {
+            std::string testCase;
+            std::string description;
+            ResultCounts counts;
+        };
+
+        /**
+         * Count a batch of results, in a single pass.
+         *
+         * @param results
+         */
+        void add(const TestResults &results) noexcept(false) {
+            // Count per scope of the batch first, so the names are only looked up once per scope
+            const std::vector<TestResults::Scope> &scopes = results.scopes();
+            m_batch.assign(scopes.size(), {});
+            for (ResultRef result: results) {
+                m_batch[result.scopeIndex()].add(result);
+            }
+
+            for (size_t i = 0; i < scopes.size(); ++i) {
+                const ResultCounts &counts = m_batch[i];
+                m_totals += counts;
+                findOrAdd(scopes[i].testCase, scopes[i].description).counts += counts;
+                findOrAdd(scopes[i].testCase).counts += counts;
+            }
+        }
+
+        /**
+         * Counts across all results.
+         *
+         * @return
+         */
+        [[nodiscard]] const ResultCounts &totals() const noexcept {
+            return m_totals;
+        }
+
+        /**
+         * Counts per test case, in the order they were first seen.
+         *
+         * @return
+         */
+        [[nodiscard]] const std::vector<CaseCounts> &cases() const noexcept {
+            return m_cases;
+        }
+
+        /**
+         * Counts per ``it`` scope, in the order they were first seen.
+         *
+         * @return
+         */
+        [[nodiscard]] const std::vector<ScopeCounts> &scopes() const noexcept {
+            return m_scopes;
+        }
+
+        /**
+         * Counts of a test case, or ``nullptr`` when it hasn't been seen.
+         *
+         * @param testCase
+         * @return
+         */
+        [[nodiscard]] const ResultCounts *find(const std::string &testCase) const noexcept(false) {
+            auto it = m_caseIndex.find(testCase);
+            return it == m_caseIndex.end() ? nullptr : &m_cases[it->second].counts;
+        }
+
+        /**
+         * Counts of an ``it`` scope, or ``nullptr`` when it hasn't been seen.
+         *
+         * @param testCase
+         * @param description
+         * @return
+         */
+        [[nodiscard]] const ResultCounts *find(const std::string &testCase,
+                                               const std::string &description) const noexcept(false) {
+            auto it = m_scopeIndex.find(scopeKey(testCase, description));
+            return it == m_scopeIndex.end() ? nullptr : &m_scopes[it->second].counts;
+        }
+
+        void clear() noexcept {
+            m_totals = {};
+            m_cases.clear();
+            m_scopes.clear();
+            m_caseIndex.clear();
+            m_scopeIndex.clear();
+        }
+
+    private:
+        ResultCounts m_totals;
+
+        std::vector<CaseCounts> m_cases;
+        std::vector<ScopeCounts> m_scopes;
+
+        std::unordered_map<std::string, size_t> m_caseIndex;
+        std::unordered_map<std::string, size_t> m_scopeIndex;
+
+        /**
+         * Counts per scope of the batch being added, kept to reuse its memory.
+         */
+        std::vector<ResultCounts> m_batch;
+
+        static std::string scopeKey(const std::string &testCase, const std::string &description) {
+            std::string key;
+            key.reserve(testCase.size() + description.size() + 1);
+            key.append(testCase).append(1, '\0').append(description);
+            return key;
+        }
+
+        CaseCounts &findOrAdd(const std::string &testCase) {
+            auto [it, added] = m_caseIndex.try_emplace(testCase, m_cases.size());
+            if (added) {
+                m_cases.push_back({.testCase = testCase});
+            }
+            return m_cases[it->second];
+        }
+
+        ScopeCounts &findOrAdd(const std::string &testCase, const std::string &description) {
+            auto [it, added] = m_scopeIndex.try_emplace(scopeKey(testCase, description), m_scopes.size());
+            if (added) {
+                m_scopes.push_back({.testCase = testCase, .description = description});
+            }
+            return m_scopes[it->second];
+        }
+    };
+
+    /**
+     * Sink which keeps a ``ResultSummary`` up to date as results arrive,
+     * without keeping the results themselves.
+     */
+    class SummarySink : public ResultSink {
+    public:
+        /**
+         * The summary of the results so far. Read it when the run is complete.
+         *
+         * @return
+         */
+        [[nodiscard]] const ResultSummary &summary() const noexcept {
+            return m_summary;
+        }
+
+    protected:
+        void consume(TestResults &&results) override {
+            m_summary.add(results);
+        }
+
+    private:
+        ResultSummary m_summary;
+    };
+}
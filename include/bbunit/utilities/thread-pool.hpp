@@ -0,0 +1,282 @@
+/**
+ * C++ BBUnit - Thread pool utility
+ *
+ * A small work-stealing thread pool, used to run test cases
+ * (and other independent units of work) across multiple cores.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace BBUnit::Utilities {
+    /**
+     * Work-stealing thread pool.
+     *
+     * Every worker owns a queue. Workers take work from the back of their
+     * own queue, and when it runs dry, they steal from the front of the
+     * other workers' queues. The thread which calls ``forEach`` participates
+     * in the work, which also makes nested calls safe.
+     */
+    class ThreadPool {
+    public:
+        /**
+         * Create a pool with the given level of concurrency.
+         *
+         * @param threads Number of threads working on the tasks (including
+         *      the calling thread). When ``0``, the hardware concurrency is used.
+         */
+        explicit ThreadPool(unsigned int threads = 0) {
+            if (threads == 0) {
+                threads = std::max(1u, std::thread::hardware_concurrency());
+            }
+
+            m_size = threads;
+            for (unsigned int i = 0; i < threads; ++i) {
+                m_queues.emplace_back(std::make_unique<Queue>());
+            }
+
+            // The calling thread is the last of the workers, so we only
+            // spawn ``threads - 1`` background threads.
+            for (unsigned int i = 0; i + 1 < threads; ++i) {
+                m_threads.emplace_back([this, i]() {
+                    workerLoop(i);
+                });
+            }
+        }
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        ~ThreadPool() {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stopping = true;
+            }
+            m_wake.notify_all();
+            for (std::thread &thread: m_threads) {
+                thread.join();
+            }
+        }
+
+        /**
+         * The level of concurrency of the pool.
+         *
+         * @return
+         */
+        [[nodiscard]] unsigned int size() const noexcept {
+            return m_size;
+        }
+
+        /**
+         * Call ``func`` for every index in ``[0, count)``, and block until
+         * all calls have completed.
+         *
+         * If one or more calls throw, the exception belonging to the lowest
+         * index is re-thrown once everything has completed.
+         *
+         * @param count
+         * @param func
+         */
+        void forEach(size_t count, const std::function<void(size_t)> &func) noexcept(false) {
+            if (count == 0) {
+                return;
+            }
+
+            Batch batch;
+            batch.remaining = count;
+
+            // Hand out contiguous ranges, so each worker initially works through
+            // its own part of the list, and only steals when it's done. Workers
+            // take their newest task first, so a part runs in reverse order,
+            // while thieves take from the other end.
+            const size_t queues = m_queues.size();
+            for (size_t q = 0; q < queues; ++q) {
+                size_t from = count * q / queues, to = count * (q + 1) / queues;
+                std::lock_guard<std::mutex> lock(m_queues[q]->mutex);
+                for (size_t i = from; i < to; ++i) {
+                    m_queues[q]->tasks.emplace_back([&batch, &func, i]() {
+                        runTask(batch, func, i);
+                    });
+                }
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_pending += count;
+            }
+            m_wake.notify_all();
+
+            // The calling thread helps out, until its own batch is done.
+            ThreadPool *previous = currentPool();
+            currentPool() = this;
+            size_t self = isOwnWorker() ? currentWorker() : queues - 1;
+            while (batch.remaining.load() > 0) {
+                if (!tryRun(self)) {
+                    std::unique_lock<std::mutex> lock(batch.mutex);
+                    batch.done.wait_for(lock, std::chrono::milliseconds(1), [&]() {
+                        return batch.remaining.load() == 0;
+                    });
+                }
+            }
+            currentPool() = previous;
+
+            // Synchronize with the thread which completed the last task, so
+            // it's no longer touching ``batch`` when we leave the scope.
+            std::unique_lock<std::mutex> lock(batch.mutex);
+
+            if (batch.error) {
+                std::rethrow_exception(batch.error);
+            }
+        }
+
+        /**
+         * The pool which the current thread is working for, if any.
+         *
+         * @return
+         */
+        [[nodiscard]] static ThreadPool *current() noexcept {
+            return currentPool();
+        }
+
+    private:
+        /**
+         * Per-worker task queue.
+         */
+        struct Queue {
+            std::mutex mutex;
+            std::deque<std::function<void()>> tasks;
+        };
+
+        /**
+         * Book-keeping for a single ``forEach`` call.
+         */
+        struct Batch {
+            std::atomic<size_t> remaining = 0;
+            std::mutex mutex;
+            std::condition_variable done;
+            std::exception_ptr error;
+            size_t errorIndex = 0;
+        };
+
+        unsigned int m_size = 1;
+
+        std::vector<std::unique_ptr<Queue>> m_queues;
+
+        std::vector<std::thread> m_threads;
+
+        /**
+         * Guards ``m_pending`` and ``m_stopping`` for the sleeping workers.
+         */
+        std::mutex m_mutex;
+
+        std::condition_variable m_wake;
+
+        std::atomic<size_t> m_pending = 0;
+
+        bool m_stopping = false;
+
+        static ThreadPool *&currentPool() noexcept {
+            thread_local ThreadPool *pool = nullptr;
+            return pool;
+        }
+
+        static size_t &currentWorker() noexcept {
+            thread_local size_t worker = 0;
+            return worker;
+        }
+
+        static const ThreadPool *&workerOwner() noexcept {
+            thread_local const ThreadPool *owner = nullptr;
+            return owner;
+        }
+
+        [[nodiscard]] bool isOwnWorker() const noexcept {
+            return workerOwner() == this;
+        }
+
+        static void runTask(Batch &batch, const std::function<void(size_t)> &func, size_t index) noexcept {
+            std::exception_ptr error;
+            try {
+                func(index);
+            } catch (...) {
+                error = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> lock(batch.mutex);
+            if (error && (!batch.error || index < batch.errorIndex)) {
+                batch.error = error;
+                batch.errorIndex = index;
+            }
+            if (--batch.remaining == 0) {
+                batch.done.notify_all();
+            }
+        }
+
+        /**
+         * Run one task: preferably the newest from our own queue, otherwise
+         * the oldest one we can steal from another worker.
+         *
+         * @param self
+         * @return False, when there was nothing to do.
+         */
+        bool tryRun(size_t self) {
+            std::function<void()> task;
+
+            {
+                Queue &own = *m_queues[self];
+                std::lock_guard<std::mutex> lock(own.mutex);
+                if (!own.tasks.empty()) {
+                    task = std::move(own.tasks.back());
+                    own.tasks.pop_back();
+                }
+            }
+
+            for (size_t i = 1; !task && i < m_queues.size(); ++i) {
+                Queue &victim = *m_queues[(self + i) % m_queues.size()];
+                std::lock_guard<std::mutex> lock(victim.mutex);
+                if (!victim.tasks.empty()) {
+                    task = std::move(victim.tasks.front());
+                    victim.tasks.pop_front();
+                }
+            }
+
+            if (!task) {
+                return false;
+            }
+
+            --m_pending;
+            task();
+            return true;
+        }
+
+        void workerLoop(size_t index) {
+            currentPool() = this;
+            currentWorker() = index;
+            workerOwner() = this;
+
+            while (true) {
+                if (tryRun(index)) {
+                    continue;
+                }
+
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wake.wait(lock, [&]() {
+                    return m_stopping || m_pending.load() > 0;
+                });
+                if (m_stopping && m_pending.load() == 0) {
+                    return;
+                }
+            }
+        }
+    };
+}
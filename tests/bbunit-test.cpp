@@ -1,6 +1,39 @@
 #include <bbunit/bbunit.hpp>
+#include <bbunit/utilities/mapped-file.hpp>
+#include <filesystem>
+#include <fstream>
+#include <list>
 #include <map>
+#include <numeric>
 #include <optional>
+#include <unordered_map>
+
+namespace BBUnit::Tests {
+    struct Point {
+        int x, y;
+
+        bool operator==(const Point &other) const = default;
+    };
+
+    struct Streamable {
+        int id;
+
+        friend std::ostream &operator<<(std::ostream &stream, const Streamable &value) {
+            return stream << "Streamable #" << value.id;
+        }
+    };
+}
+
+template<>
+struct BBUnit::Formatter<BBUnit::Tests::Point> {
+    static void format(std::string &out, const BBUnit::Tests::Point &point) {
+        out += "Point(";
+        Formatter<int>::format(out, point.x);
+        out += ", ";
+        Formatter<int>::format(out, point.y);
+        out += ")";
+    }
+};
 
 namespace BBUnit::Tests {
     class BBUnitTest : public TestCase {
@@ -19,6 +52,15 @@ namespace BBUnit::Tests {
             regex();
             catchUnintendedErrors();
             optional();
+            results();
+            benchmarks();
+            properties();
+            dataDriven();
+            numeric();
+            diffs();
+            formatting();
+            allocations();
+            hardwareCounters();
         }
 
         /**
@@ -120,6 +162,12 @@ namespace BBUnit::Tests {
          * Test performed in a number of common formats.
          */
         void expectedActual() {
+            // Values of passed assertions are only rendered upon request
+            Settings settings = getSettings();
+            Settings recordPassed = settings;
+            recordPassed.recordPassedValues = true;
+            withSettings(recordPassed);
+
             TestResults general = whileSilent([&]() -> TestResults {
                 return it("", [&]() {
                     assertNotEquals<std::string>("a", "b");
@@ -130,6 +178,22 @@ namespace BBUnit::Tests {
                 });
             });
 
+            withSettings(settings);
+
+            TestResults lazy = whileSilent([&]() -> TestResults {
+                return it("", [&]() {
+                    assertEquals<int>(2, 2);
+                    assertEquals<int>(2, 23);
+                });
+            });
+
+            it("Only renders expected and actual for failed assertions by default", [&]() {
+                assertTrue(lazy[0].get().expected.empty());
+                assertTrue(lazy[0].get().actual.empty());
+                assertEquals<std::string>("2", lazy[1].get().expected);
+                assertEquals<std::string>("23", lazy[1].get().actual);
+            });
+
             it("Test that expected and actual are reported", [&]() {
                 // std::string
                 assertEquals<std::string>("a", general[0].get().expected);
@@ -144,12 +208,12 @@ namespace BBUnit::Tests {
                 assertEquals<std::string>("23", general[2].get().actual);
 
                 // float
-                assertEquals<std::string>("5.5", general[3].get().expected.substr(0, 3));
-                assertEquals<std::string>("6.5", general[3].get().actual.substr(0, 3));
+                assertEquals<std::string>("5.5", general[3].get().expected);
+                assertEquals<std::string>("6.5", general[3].get().actual);
 
                 // double
-                assertEquals<std::string>("5.5", general[4].get().expected.substr(0, 3));
-                assertEquals<std::string>("6.5", general[4].get().actual.substr(0, 3));
+                assertEquals<std::string>("5.5", general[4].get().expected);
+                assertEquals<std::string>("6.5", general[4].get().actual);
             });
         }
 
@@ -214,6 +278,42 @@ namespace BBUnit::Tests {
                 assertRegex(R"(^\d+$)", "123123").thisCase(Must::HavePassed);
                 assertRegex(R"(^\d+$)", "123abc").thisCase(Must::HaveFailed);
             });
+
+            it("Tests precompiled regular expressions", [&]() {
+                std::regex pattern(R"(^\d+$)");
+                assertRegex(pattern, "123123").thisCase(Must::HavePassed);
+                assertRegex(pattern, "123abc").thisCase(Must::HaveFailed);
+            });
+
+            // Compile each pattern only once, by keeping it in the cache
+            Settings settings = getSettings();
+            Settings withOwnCache = settings;
+            withOwnCache.regexCache = std::make_shared<Utilities::RegexCache>();
+            withSettings(withOwnCache);
+
+            it("Caches compiled regular expressions", [&]() {
+                assertRegex(R"(^[a-z]+$)", "abc");
+                assertRegex(R"(^[a-z]+$)", "def");
+                assertRegex(R"(^[a-z]+$)", "ABC", std::regex::icase);
+                assertRegex(R"(^[a-z]+$)", "GHI", std::regex::icase);
+
+                assertEquals<size_t>(2, withOwnCache.regexCache->misses());
+                assertEquals<size_t>(2, withOwnCache.regexCache->hits());
+                assertEquals<size_t>(2, withOwnCache.regexCache->size());
+            });
+
+            Settings withoutCache = settings;
+            withoutCache.regexCache = nullptr;
+            withSettings(withoutCache);
+
+            it("Compiles regular expressions without a cache", [&]() {
+                assertRegex(R"(^[a-z]+$)", "abc").thisCase(Must::HavePassed);
+                assertRegex(R"(^[a-z]+$)", "ABC").thisCase(Must::HaveFailed);
+                assertTrue(Settings().regexCache == Settings().regexCache);
+                assertTrue(Settings().regexCache == Utilities::RegexCache::shared());
+            });
+
+            withSettings(settings);
         }
 
         /**
@@ -297,5 +397,661 @@ namespace BBUnit::Tests {
                 assertEquals(10, hasValue).thisCase(Must::HavePassed);
             });
         }
+
+        /**
+         * Checks the ``TestResults`` container, which stores results in a
+         * compact form, and hands them out as ``ResultRef`` views.
+         */
+        void results() {
+            TestResults first = whileSilent([&]() -> TestResults {
+                return it("First scope", [&]() {
+                    assertTrue(true);
+                    assertEquals<int>(1, 2).because("One is not two");
+                });
+            });
+
+            TestResults second = whileSilent([&]() -> TestResults {
+                return it("Second scope", [&]() {
+                    assertTrue(true).because("It's true");
+                });
+            });
+
+            it("Stores results compactly and hands them out as views", [&]() {
+                assertTrue(first[0].passed());
+                assertTrue(first[0].expected().empty());
+                assertEquals<std::string>("First scope", first[0].description());
+                assertFalse(first[1].passed());
+                assertEquals<std::string>("One is not two", first[1].additional());
+                assertEquals<std::string>("1", first[1].expected());
+                assertEquals<CaseNumber>(2, first[1].caseNo());
+                assertEquals<std::string>("It's true", second[0].get().info.additional);
+            });
+
+            it("Appends results from other containers", [&]() {
+                TestResults merged;
+                merged += first;
+                merged += second;
+
+                assertCount(3, merged);
+                assertEquals<std::string>("First scope", merged[1].description());
+                assertEquals<std::string>("One is not two", merged[1].additional());
+                assertEquals<std::string>("Second scope", merged[2].description());
+                assertEquals<std::string>("It's true", merged[2].additional());
+            });
+
+            it("Accepts and replaces results in their expanded form", [&]() {
+                TestResults res = {
+                        TestResult{.info = {.caseNo = 1, .description = "A"}, .passed = true},
+                        Error{.info = {.description = "B"}, .errorCode = ErrorCode::ExceptionCaught, .message = "Oops"},
+                };
+                res.set(0, TestResult{.info = {.caseNo = 4, .description = "C"}, .passed = false, .expected = "x"});
+
+                assertFalse(res[0].passed());
+                assertEquals<CaseNumber>(4, res[0].caseNo());
+                assertEquals<std::string>("C", res[0].description());
+                assertEquals<std::string>("x", res[0].expected());
+                assertTrue(res[1].isErr());
+                assertEquals<std::string>("B", res[1].description());
+                assertEquals<std::string>("Oops", res[1].error().message);
+            });
+        }
+
+        /**
+         * Checks the benchmarking, including the statistics and the
+         * assertions made on them.
+         */
+        void benchmarks() {
+            it("Computes statistics from benchmark samples", [&]() {
+                BenchmarkStats stats = BenchmarkStats::fromSamples({5, 1, 4, 2, 3, 100, 6, 7, 8, 9});
+                assertEquals<double>(5.5, stats.median.count());
+                assertEquals<double>(100, stats.p95.count());
+                assertEquals<double>(1, stats.min.count());
+                assertEquals<double>(14.5, stats.mean.count());
+                assertEquals<long long>(30, std::llround(stats.stddev));
+            });
+
+            // Keep the measurements short, since we only check the mechanics
+            BenchmarkOptions quick{
+                    .warmUpTime = std::chrono::microseconds(100),
+                    .measureTime = std::chrono::milliseconds(1),
+                    .samples = 5,
+            };
+
+            int counter = 0;
+            TestResults measured = whileSilent([&]() -> TestResults {
+                return benchmark("Increments a counter", [&]() {
+                    doNotOptimize(++counter);
+                }, [&](const BenchmarkStats &stats) {
+                    assertFasterThan(stats, std::chrono::seconds(1));
+                    assertFasterThan(stats, std::chrono::nanoseconds(0));
+                }, quick);
+            });
+
+            it("Measures and asserts the duration of a benchmark", [&]() {
+                assertCount(3, measured);
+                assertTrue(measured[0].passed());
+                assertRegex("^median .+, p95 .+, stddev .+ \\(5 x \\d+ calls\\)$", measured[0].additional());
+                assertTrue(measured[1].passed());
+                assertFalse(measured[2].passed());
+                assertEquals<std::string>("median < 0 ns", measured[2].expected());
+                assertTrue(counter > 0);
+            });
+
+            Settings settings = getSettings();
+            Settings withBaseline = settings;
+            withBaseline.benchmarkBaseline = std::make_shared<BenchmarkBaseline>();
+            withBaseline.benchmarkBaseline->set("Slower than baseline", std::chrono::nanoseconds(0));
+            withBaseline.benchmarkBaseline->set("Faster than baseline", std::chrono::seconds(1));
+            withSettings(withBaseline);
+
+            // Waits for the clock to tick, so every call provably takes longer than the 0 ns baseline
+            auto tick = []() {
+                auto start = std::chrono::steady_clock::now();
+                while (std::chrono::steady_clock::now() == start) {}
+            };
+
+            TestResults compared = whileSilent([&]() -> TestResults {
+                TestResults res;
+                for (const char *description: {"Slower than baseline", "Faster than baseline", "New benchmark"}) {
+                    res += benchmark(description, tick, [&](const BenchmarkStats &stats) {
+                        assertNoSlowerThanBaseline(stats);
+                    }, quick);
+                }
+                return res;
+            });
+            TestResults skipped = whileSilent([&]() -> TestResults {
+                return benchmark("Skipped benchmark", tick, [&](const BenchmarkStats &stats) {
+                    assertTrue(false);
+                    assertNoSlowerThanBaseline(stats);
+                }, quick);
+            });
+
+            withSettings(settings);
+
+            it("Compares benchmarks to a baseline", [&]() {
+                assertFalse(compared[1].passed());
+                assertTrue(compared[3].passed());
+                assertTrue(compared[5].passed());
+                assertEquals<std::string>("No baseline", compared[5].additional());
+                assertTrue(withBaseline.benchmarkBaseline->find("New benchmark").has_value());
+            });
+
+            it("Leaves the baseline alone, when the comparison is skipped", [&]() {
+                assertFalse(withBaseline.benchmarkBaseline->find("Skipped benchmark").has_value());
+                for (ResultRef result: skipped) {
+                    assertTrue(result.additional() != "No baseline");
+                }
+            });
+        }
+
+        /**
+         * Property-based testing with ``forAll``.
+         */
+        void properties() {
+            it("Generates reproducible random numbers", [&]() {
+                Random first(42, 7), second(42, 7), other(42, 8);
+                uint64_t a = first.next();
+                assertTrue(a == second.next());
+                assertTrue(a != other.next());
+
+                bool inRange = true;
+                for (int i = 0; i < 1000; ++i) {
+                    int n = first.between(-3, 3);
+                    inRange = inRange && n >= -3 && n <= 3;
+                }
+                assertTrue(inRange);
+            });
+
+            PropertyOptions seeded{.seed = 42};
+            // Each property in a scope of its own, since a failure stops the scope
+            TestResults res = whileSilent([&]() -> TestResults {
+                TestResults all;
+                all += it("", [&]() {
+                    forAll(Generators::Integers<int>(), [](int a) {
+                        return a + 0 == a;
+                    });
+                });
+                all += it("", [&]() {
+                    forAll(seeded, Generators::Integers<int>(0, 1000), [](int a) {
+                        return a < 100;
+                    });
+                });
+                all += it("", [&]() {
+                    forAll(seeded, Generators::Strings(), Generators::Integers<int>(0, 10), [](const std::string &s, int n) {
+                        return s.size() < 5 || n < 3;
+                    });
+                });
+                all += it("", [&]() {
+                    forAll(seeded, Generators::Vectors(Generators::Integers<int>(-100, 100)), [](const std::vector<int> &v) {
+                        return std::all_of(v.begin(), v.end(), [](int n) { return n <= 50; });
+                    });
+                });
+                all += it("", [&]() {
+                    forAll(seeded, Generators::Optionals(Generators::Floats<double>()), [](std::optional<double> d) {
+                        if (d.has_value() && *d > 10.5) {
+                            throw std::runtime_error("Too large");
+                        }
+                        return true;
+                    });
+                });
+                return all;
+            });
+
+            it("Passes when the property holds for all inputs", [&]() {
+                assertTrue(res[0].passed());
+            });
+
+            it("Shrinks the failing input to a minimal counterexample", [&]() {
+                assertEquals<std::string>("Holds for 1000 inputs (seed 42)", res[1].expected());
+                assertRegex("^Fails for 100 after \\d+ inputs and \\d+ shrinks$", res[1].actual());
+                assertRegex("^Fails for \\(\"     \", 3\\) after", res[2].actual());
+                assertRegex("^Fails for \\[51\\] after", res[3].actual());
+            });
+
+            it("Treats an exception as failing", [&]() {
+                assertRegex("^Fails for 11 after .+, throwing: Too large$", res[4].actual());
+            });
+
+            it("Rejects strings from an empty alphabet", [&]() {
+                bool thrown = false;
+                try {
+                    Generators::Strings(8, "");
+                } catch (const std::invalid_argument &) {
+                    thrown = true;
+                }
+                assertTrue(thrown);
+            });
+
+            it("Reports the same counterexample when checking in parallel", [&]() {
+                PropertyOptions parallel{.seed = 42, .threads = 4};
+                auto property = [](const std::vector<int> &v) {
+                    return v.size() < 10;
+                };
+                Generators::Vectors vectors{Generators::Integers<int>()};
+                PropertyOutcome serial = Property::check(seeded, property, vectors);
+                PropertyOutcome threaded = Property::check(parallel, property, vectors);
+                assertFalse(serial.passed);
+                assertEquals<std::string>(serial.counterexample, threaded.counterexample);
+                assertEquals<size_t>(serial.tests, threaded.tests);
+                assertEquals<std::string>("[0, 0, 0, 0, 0, 0, 0, 0, 0, 0]", serial.counterexample);
+            });
+        }
+
+        /**
+         * Data-driven scopes with ``itEach``, and tables read from files.
+         */
+        void dataDriven() {
+            std::vector<std::tuple<int, int, int>> sums{{1, 2, 3}, {2, 2, 5}, {0, 0, 0}};
+
+            TestResults res = whileSilent([&]() -> TestResults {
+                TestResults all;
+                all += itEach("Adds", sums, [&](const std::tuple<int, int, int> &row) {
+                    auto [a, b, sum] = row;
+                    assertEquals<int>(sum, a + b);
+                    assertTrue(true);
+                });
+                all += itEach("Passes", std::vector<int>(1000, 1), [&](int n) {
+                    assertEquals<int>(1, n);
+                });
+                all += itEach("Throws", std::vector<int>{1, 2}, [&](int n) {
+                    if (n == 2) {
+                        throw std::runtime_error("Two");
+                    }
+                });
+                return all;
+            });
+
+            it("Only reports the failing rows, with their number and values", [&]() {
+                assertCount(6, res);
+                assertFalse(res[0].passed());
+                assertEquals<std::string>("Row 1: (2, 2, 5)", res[0].additional());
+                assertTrue(res[1].isErr());
+                assertEquals<std::string>("All 3 rows pass", res[2].expected());
+                assertEquals<std::string>("1 of 3 rows fail", res[2].actual());
+            });
+
+            it("Records a single result for a passing table", [&]() {
+                assertTrue(res[3].passed());
+                assertEquals<std::string>("Passes", res[3].description());
+            });
+
+            it("Reports exceptions thrown by a row", [&]() {
+                assertTrue(res[4].isErr());
+                assertEquals<std::string>("Two", res[4].message());
+                assertEquals<std::string>("Row 1: 2", res[4].additional());
+            });
+
+            std::filesystem::path csvPath = std::filesystem::temp_directory_path() / "bbunit-table-test.csv";
+            std::filesystem::path recordPath = std::filesystem::temp_directory_path() / "bbunit-table-test.bin";
+            {
+                std::ofstream csv(csvPath);
+                csv << "a,b,sum\r\n1,2,3\n\n4,5,x\n10,20,30";
+                std::vector<int> records{1, 2, 3, 4};
+                std::ofstream(recordPath, std::ios::binary).write(reinterpret_cast<const char *>(records.data()),
+                                                                  static_cast<std::streamsize>(records.size() * sizeof(int)));
+            }
+
+            Utilities::CsvFile table(csvPath.string());
+            TestResults fromCsv = whileSilent([&]() -> TestResults {
+                return itEach("Adds", table, [&](const Utilities::CsvRow &row) {
+                    assertEquals<int>(row.get<int>(table.column("sum")).value_or(-1), row.get<int>(0).value() + row.get<int>(1).value());
+                });
+            });
+
+            it("Reads the rows of a CSV file", [&]() {
+                assertCount(3, table.columns());
+                assertEquals<std::string>("sum", std::string(table.columns()[2]));
+                assertCount(2, fromCsv);
+                assertEquals<std::string>(R"(Row 1: ["4", "5", "x"])", fromCsv[0].additional());
+                assertEquals<std::string>("3 rows pass", fromCsv[1].expected().substr(4));
+            });
+
+            it("Reads a file of binary records", [&]() {
+                Utilities::RecordFile<int> records(recordPath.string());
+                assertCount(4, records.records());
+                assertEquals<int>(10, std::accumulate(records.begin(), records.end(), 0));
+            });
+
+            std::filesystem::remove(csvPath);
+            std::filesystem::remove(recordPath);
+        }
+
+        /**
+         * Approximate equality of floating-point values and arrays.
+         */
+        void numeric() {
+            it("Asserts that values are near each other", [&]() {
+                assertNear(0.3, 0.1 + 0.2, {.absolute = 1e-12}).thisCase(Must::HavePassed);
+                assertNear(0.3, 0.1 + 0.2, {}).thisCase(Must::HaveFailed);
+                assertNear(1000.0f, 1000.1f, {.relative = 1e-3}).thisCase(Must::HavePassed);
+                assertNear(1000.0f, 1001.1f, {.relative = 1e-3}).thisCase(Must::HaveFailed);
+                assertNear(1.0f, std::nextafter(std::nextafter(1.0f, 2.0f), 2.0f), {.ulps = 2}).thisCase(Must::HavePassed);
+                assertNear(1.0f, std::nextafter(std::nextafter(1.0f, 2.0f), 2.0f), {.ulps = 1}).thisCase(Must::HaveFailed);
+                assertNear(NAN, NAN, {.absolute = 1}).thisCase(Must::HaveFailed);
+                assertNear(NAN, NAN, {.nanEqual = true}).thisCase(Must::HavePassed);
+                assertNear(INFINITY, INFINITY, {}).thisCase(Must::HavePassed);
+            });
+
+            it("Counts units in the last place across zero", [&]() {
+                assertEquals<uint64_t>(0, Numeric::ulpDistance(-0.0f, 0.0f));
+                assertEquals<uint64_t>(2, Numeric::ulpDistance(-std::numeric_limits<double>::denorm_min(),
+                                                                std::numeric_limits<double>::denorm_min()));
+            });
+
+            // A size which isn't a multiple of the SIMD width, with mismatches in both parts
+            std::vector<float> expected(1003), actual(1003);
+            for (size_t i = 0; i < expected.size(); ++i) {
+                expected[i] = actual[i] = static_cast<float>(i) / 7;
+            }
+            actual[17] += 0.5f;
+            actual[1001] = NAN;
+            actual[500] += 2;
+
+            TestResults res = whileSilent([&]() -> TestResults {
+                TestResults all;
+                all += it("", [&]() {
+                    assertAllClose(expected, actual, {.absolute = 1e-3});
+                });
+                all += it("", [&]() {
+                    assertAllClose(expected, std::vector<float>(3), {});
+                });
+                return all;
+            });
+
+            it("Reports the mismatches of arrays, rather than their contents", [&]() {
+                assertEquals<std::string>("All 1003 elements within abs 0.001", res[0].expected());
+                assertEquals<std::string>("3 mismatches, first at [17] 2.9285715 (expected 2.4285715), "
+                                          "max error inf at [1001] nan (expected 143)", res[0].actual());
+                assertEquals<std::string>("3 elements", res[1].actual());
+            });
+
+            it("Compares arrays and spans of doubles", [&]() {
+                std::array<double, 5> values{1, 2, 3, 4, 5};
+                std::vector<double> close{1, 2, 3, 4, 5.0000001};
+                assertAllClose(values, close, {.relative = 1e-6}).thisCase(Must::HavePassed);
+                assertAllClose(std::span<const double>(values).first(4), std::span<const double>(close).first(4), {})
+                        .thisCase(Must::HavePassed);
+                assertAllClose(values, close, {}).thisCase(Must::HaveFailed);
+            });
+        }
+
+        /**
+         * Container and byte buffer comparisons, which describe only a few differences.
+         */
+        void diffs() {
+            it("Compares sequences element by element", [&]() {
+                std::vector<int> values{1, 2, 3};
+                assertContainerEquals(values, std::array<int, 3>{1, 2, 3}).thisCase(Must::HavePassed);
+                assertContainerEquals(std::list<std::string>{"a"}, std::vector<std::string>{"a"}).thisCase(Must::HavePassed);
+                assertContainerEquals(values, std::vector<int>{1, 2, 4}).thisCase(Must::HaveFailed);
+                assertContainerEquals(values, std::vector<int>{1, 2}).thisCase(Must::HaveFailed);
+                assertContainerEquals(std::vector<double>{0.0}, std::vector<double>{-0.0}).thisCase(Must::HavePassed);
+            });
+
+            it("Compares maps by key", [&]() {
+                using Map = std::map<std::string, int>;
+                using UnorderedMap = std::unordered_map<int, int>;
+                assertContainerEquals(Map{{"a", 1}, {"b", 2}}, Map{{"a", 1}, {"b", 2}}).thisCase(Must::HavePassed);
+                assertContainerEquals(Map{{"a", 1}, {"b", 2}}, Map{{"a", 1}, {"b", 3}}).thisCase(Must::HaveFailed);
+                assertContainerEquals(UnorderedMap{{1, 1}, {2, 2}}, UnorderedMap{{2, 2}, {1, 1}}).thisCase(Must::HavePassed);
+                assertContainerEquals(UnorderedMap{{1, 1}, {2, 2}}, UnorderedMap{{1, 1}}).thisCase(Must::HaveFailed);
+            });
+
+            std::vector<int> many(1000);
+            std::vector<int> changed = many;
+            for (size_t i = 10; i < 1000; i += 100) {
+                changed[i] = 1;
+            }
+            std::vector<uint8_t> buffer(64);
+            std::iota(buffer.begin(), buffer.end(), 0);
+            std::vector<uint8_t> corrupted = buffer;
+            corrupted[40] = 0xff;
+            corrupted[42] = 0xee;
+
+            TestResults res = whileSilent([&]() -> TestResults {
+                TestResults all;
+                all += it("", [&]() {
+                    assertContainerEquals(many, changed, {.maxDifferences = 2});
+                });
+                all += it("", [&]() {
+                    assertContainerEquals(std::vector<std::string>{"a", "b"}, std::vector<std::string>{"a", "c", "d"});
+                });
+                all += it("", [&]() {
+                    assertContainerEquals(std::map<std::string, int>{{"a", 1}, {"b", 2}},
+                                          std::map<std::string, int>{{"b", 3}, {"c", 4}});
+                });
+                all += it("", [&]() {
+                    assertBytesEqual(buffer, corrupted, {.context = 4});
+                });
+                all += it("", [&]() {
+                    assertBytesEqual(buffer, std::span(buffer).first(4), {.context = 2});
+                });
+                return all;
+            });
+
+            it("Describes a bounded number of differences", [&]() {
+                assertEquals<std::string>("1000 elements", res[0].expected());
+                assertEquals<std::string>("1000 elements, 10 differences: [10] 1 (expected 0), "
+                                          "[110] 1 (expected 0), and 8 more", res[0].actual());
+                assertEquals<std::string>(R"(3 elements, 2 differences: [1] "c" (expected "b"), [2] "d" (unexpected))",
+                                          res[1].actual());
+                assertEquals<std::string>(R"(2 elements, 3 differences: ["a"] missing (expected 1), )"
+                                          R"(["b"] 3 (expected 2), ["c"] 4 (unexpected))", res[2].actual());
+            });
+
+            it("Shows the bytes around the first difference", [&]() {
+                assertEquals<std::string>("64 bytes; 0x0024: 24 25 26 27 [28] 29 [2a] 2b 2c", res[3].expected());
+                assertEquals<std::string>("64 bytes, 2 differ from 0x0028; 0x0024: 24 25 26 27 [ff] 29 [ee] 2b 2c",
+                                          res[3].actual());
+                assertEquals<std::string>("4 bytes, 60 differ from 0x0004; 0x0002: 02 03", res[4].actual());
+            });
+
+            it("Compares byte buffers of any trivially copyable type", [&]() {
+                std::array<uint32_t, 2> words{1, 2};
+                assertBytesEqual(words, std::vector<uint32_t>{1, 2}).thisCase(Must::HavePassed);
+                assertBytesEqual(std::string("abc"), std::string("abd")).thisCase(Must::HaveFailed);
+                assertBytesEqual(std::vector<char>(), std::string()).thisCase(Must::HavePassed);
+            });
+        }
+
+        /**
+         * Rendering of values with ``Formatter``, including a specialization for ``Point``.
+         */
+        void formatting() {
+            it("Formats numbers, enums and pointers", [&]() {
+                enum class Level : uint8_t { Low = 3 };
+                assertEquals<std::string>("0.1", Format::toString(0.1));
+                assertEquals<std::string>("-2.5", Format::toString(-2.5f));
+                assertEquals<std::string>("18446744073709551615", Format::toString(UINT64_MAX));
+                assertEquals<std::string>("3", Format::toString(Level::Low));
+                assertEquals<std::string>("a", Format::toString('a'));
+                assertEquals<std::string>("true", Format::toString(true));
+                assertEquals<std::string>("nullptr", Format::toString(static_cast<int *>(nullptr)));
+                assertEquals<std::string>("0x10", Format::toString(reinterpret_cast<int *>(16)));
+            });
+
+            it("Formats ranges, tuples and optionals", [&]() {
+                assertEquals<std::string>(R"(["a", "b"])", Format::toString(std::vector<std::string>{"a", "b"}));
+                assertEquals<std::string>(R"((1, 'x', "y"))", Format::toString(std::tuple<int, char, std::string>{1, 'x', "y"}));
+                assertEquals<std::string>(R"([("a", 1)])", Format::toString(std::map<std::string, int>{{"a", 1}}));
+                assertEquals<std::string>("[1, <No value>]", Format::toString(std::vector<std::optional<int>>{1, {}}));
+                assertEquals<std::string>("[0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, "
+                                          "0, 0, 0, 0, 0, 0, 0, 0, 0, 0, and 68 more]", Format::toString(std::vector<int>(100)));
+            });
+
+            it("Formats user types", [&]() {
+                assertEquals<std::string>("Point(1, 2)", Format::toString(Point{1, 2}));
+                assertEquals<std::string>("[Point(3, 4)]", Format::toString(std::vector<Point>{{3, 4}}));
+                assertEquals<std::string>("Streamable #7", Format::toString(Streamable{7}));
+                assertEquals<std::string>("<Value>", Format::toString(std::less<>()));
+            });
+
+            TestResults res = whileSilent([&]() -> TestResults {
+                return it("", [&]() {
+                    assertEquals<Point>({1, 2}, {1, 3});
+                });
+            });
+
+            it("Uses the formatter for expected and actual values", [&]() {
+                assertEquals<std::string>("Point(1, 2)", res[0].expected());
+                assertEquals<std::string>("Point(1, 3)", res[0].actual());
+            });
+        }
+
+        /**
+         * Allocation tracking, which the self-test enables in ``main.cpp``.
+         */
+        void allocations() {
+            std::vector<int> kept;
+
+            it("Asserts the number of allocations", [&]() {
+                assertTrue(Allocations::enabled());
+                assertNoAllocations([&]() {
+                    kept.clear();
+                }).thisCase(Must::HavePassed);
+                assertNoAllocations([&]() {
+                    kept.assign(10, 1);
+                }).thisCase(Must::HaveFailed);
+                assertAllocationsAtMost(1, [&]() {
+                    kept.assign(100, 1);
+                }).thisCase(Must::HavePassed);
+                assertAllocationsAtMost(1, [&]() {
+                    kept = std::vector<int>(1000);
+                    std::vector<int> copy = kept;
+                }).thisCase(Must::HaveFailed);
+            });
+
+            kept = std::vector<int>();
+            TestResults res = whileSilent([&]() -> TestResults {
+                TestResults all;
+                all += it("", [&]() {
+                    assertNoAllocations([&]() {
+                        kept.assign(3, 1);
+                    });
+                });
+                kept = std::vector<int>();
+                all += it("", [&]() {
+                    std::vector<char> temporary(1000);
+                    temporary.clear();
+                    temporary.shrink_to_fit();
+                    kept.assign(25, 1);
+                    assertTrue(true);
+                });
+                return all;
+            });
+
+            it("Reports the allocations", [&]() {
+                assertEquals<std::string>("No allocations", res[0].expected());
+                assertEquals<std::string>("1 allocations (12 bytes)", res[0].actual());
+            });
+
+            it("Counts the allocations of every scope, and what they leak", [&]() {
+                const AllocationCounts &counts = res.scopes()[1].allocations;
+                assertEquals<uint64_t>(2, counts.allocations);
+                assertEquals<uint64_t>(1, counts.deallocations);
+                assertEquals<uint64_t>(1100, counts.bytes);
+                assertEquals<uint64_t>(1000, counts.peakBytes);
+                assertEquals<uint64_t>(1, counts.leaked);
+                assertEquals<uint64_t>(100, counts.leakedBytes);
+            });
+
+            it("Counts memory released while paused", [&]() {
+                std::vector<int> released;
+                AllocationCounts counts = Allocations::measure([&]() {
+                    released.assign(10, 1);
+                    Allocations::Pause pause;
+                    released = std::vector<int>();
+                });
+                assertEquals<uint64_t>(1, counts.allocations);
+                assertEquals<uint64_t>(0, counts.leaked);
+            });
+        }
+
+        /**
+         * Hardware performance counters, which depend on whether the kernel
+         * permits them, so both outcomes are checked.
+         */
+        void hardwareCounters() {
+            bool available = Utilities::PerfCounters::available();
+            std::vector<int> values(1000, 1);
+            auto sum = [&]() {
+                int total = 0;
+                for (int value: values) {
+                    doNotOptimize(total += value);
+                }
+            };
+
+            it("Reads the counters, or tells why they're unavailable", [&]() {
+                Utilities::CounterValues start = Utilities::PerfCounters::read();
+                sum();
+                Utilities::CounterValues counted = Utilities::PerfCounters::read().since(start);
+                if (available) {
+                    assertTrue(counted.has(Utilities::PerfCounters::Instructions));
+                    assertTrue(counted.instructions >= 1000);
+                    assertTrue(Utilities::PerfCounters::unavailableReason().empty());
+                } else {
+                    assertEquals<uint32_t>(0, counted.measured);
+                    assertFalse(Utilities::PerfCounters::unavailableReason().empty());
+                }
+            });
+
+            Settings settings = getSettings();
+            Settings counting = settings;
+            counting.countHardwareEvents = true;
+            BenchmarkStats stats = Benchmark::measure(sum, {
+                    .warmUpTime = std::chrono::microseconds(100),
+                    .measureTime = std::chrono::milliseconds(1),
+                    .samples = 5,
+            });
+
+            TestResults res = whileSilent([&]() -> TestResults {
+                TestResults all;
+                all += it("", [&]() {
+                    assertInstructionsAtMost(100000000, sum);
+                });
+                all += it("", [&]() {
+                    assertInstructionsAtMost(10, sum);
+                });
+                all += it("", [&]() {
+                    assertInstructionsAtMost(stats, 10);
+                });
+                withSettings(counting);
+                all += it("", [&]() {
+                    sum();
+                    assertTrue(true);
+                });
+                withSettings(settings);
+                return all;
+            });
+
+            it("Asserts the number of instructions, or passes with a note", [&]() {
+                assertCount(4, res);
+                assertTrue(res[0].passed());
+                if (available) {
+                    assertFalse(res[1].passed());
+                    assertEquals<std::string>("At most 10 instructions", res[1].expected());
+                    assertEquals<std::string>("At most 10 instructions per call", res[2].expected());
+                    assertRegex("^\\d+ instructions \\(\\d+ cycles\\)$", res[1].actual());
+                    assertFalse(res[2].passed());
+                    assertRegex("; .*\\d+ instructions.* per call$", stats.summary());
+                } else {
+                    assertTrue(res[1].passed());
+                    assertTrue(res[1].additional().starts_with("Not measured: hardware counters are unavailable ("));
+                    assertTrue(res[2].passed());
+                    assertRegex("^median .+ calls\\)$", stats.summary());
+                }
+            });
+
+            it("Counts the events of scopes when enabled", [&]() {
+                assertEquals<uint32_t>(0, res.scopes()[0].counters.measured);
+                const Utilities::CounterValues &counted = res.scopes()[3].counters;
+                if (available) {
+                    assertTrue(counted.has(Utilities::PerfCounters::Instructions));
+                    assertTrue(counted.instructions >= 1000);
+                } else {
+                    assertEquals<uint32_t>(0, counted.measured);
+                }
+            });
+        }
     };
 }
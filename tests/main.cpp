@@ -7,16 +7,32 @@
  * to test itself.
  */
 
+// Replace operator new and delete, so the allocation assertions can be tested
+#define BBUNIT_TRACK_ALLOCATIONS
+
 #include <bbunit/bbunit.hpp>
+#include <bbunit/utilities/command-line.hpp>
 #include <bbunit/utilities/printer.hpp>
 
 #include "./bbunit-test.cpp"
+#include "./runner-test.cpp"
 
 using namespace BBUnit;
 using namespace BBUnit::Tests;
 
-int main() {
-    TestResults results = TestRunner::run({std::make_shared<BBUnitTest>(BBUnitTest())});
+int main(int argc, char **argv) {
+    Settings settings;
+    Utilities::CommandLine::apply(argc, argv, settings);
+
+    TestResults results = TestRunner::run({
+            std::make_shared<BBUnitTest>(BBUnitTest()),
+            std::make_shared<RunnerTest>(RunnerTest()),
+    }, settings);
+
+    if (settings.listOnly) {
+        Utilities::Printer::list(results);
+        return 0;
+    }
 
     Utilities::Printer::print(results, {});
 }
@@ -0,0 +1,1025 @@
+#include <bbunit/bbunit.hpp>
+#include <bbunit/utilities/command-line.hpp>
+#include <bbunit/utilities/json-reporter.hpp>
+#include <bbunit/utilities/junit-reporter.hpp>
+#include <bbunit/utilities/printer.hpp>
+#include <bbunit/utilities/summary.hpp>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <string>
+#include <thread>
+
+namespace BBUnit::Tests {
+    /**
+     * Small test case used as a "subject" by ``RunnerTest``.
+     *
+     * It produces ``count`` passed assertions, each described with
+     * the given name, so the order of the results can be verified.
+     */
+    class SubjectCase : public TestCase {
+    public:
+        SubjectCase(std::string name, int count) : m_name(std::move(name)), m_count(count) {}
+
+        void test() override {
+            for (int i = 0; i < m_count; ++i) {
+                it(m_name, [&]() {
+                    assertTrue(true);
+                });
+            }
+        }
+
+    private:
+        std::string m_name;
+        int m_count;
+    };
+
+    /**
+     * Test case which, like the self-test, inspects the results of a silenced scope.
+     */
+    class InspectingCase : public TestCase {
+    public:
+        void test() override {
+            TestResults res = whileSilent([&]() -> TestResults {
+                return it("Subject", [&]() {
+                    assertTrue(false);
+                });
+            });
+
+            it("Inspects the subject", [&]() {
+                assertCount(1, res);
+                assertFalse(res[0].passed());
+            });
+        }
+    };
+
+    /**
+     * Test case with a single ``it`` scope of ``count`` assertions,
+     * of which the one at ``failAt`` (if any) fails.
+     */
+    class LargeScopeCase : public TestCase {
+    public:
+        explicit LargeScopeCase(int count, int failAt = -1) : m_count(count), m_failAt(failAt) {}
+
+        void test() override {
+            it("Large scope", [&]() {
+                for (int i = 0; i < m_count; ++i) {
+                    assertEquals<int>(i, i == m_failAt ? -1 : i);
+                }
+            });
+        }
+
+    private:
+        int m_count, m_failAt;
+    };
+
+    /**
+     * Sink which records the size of the batches it receives.
+     */
+    class BatchRecordingSink : public ResultCollector {
+    public:
+        std::vector<size_t> batches;
+
+        int finished = 0;
+
+    protected:
+        void consume(TestResults &&results) override {
+            batches.push_back(results.size());
+            ResultCollector::consume(std::move(results));
+        }
+
+        void done() override {
+            ++finished;
+        }
+    };
+
+    /**
+     * Test case which counts how many of its ``it`` scopes are evaluated.
+     */
+    class CountingCase : public TestCase {
+    public:
+        int evaluated = 0;
+
+        void test() override {
+            for (const char *description: {"Alpha one", "Alpha two", "Beta"}) {
+                it(description, [&]() {
+                    ++evaluated;
+                    assertTrue(true);
+                });
+            }
+        }
+    };
+
+    /**
+     * Test case with ``scopes`` scopes, which each fail their first assertion.
+     */
+    class FailingCase : public TestCase {
+    public:
+        explicit FailingCase(int scopes, int sleepMs = 0) : m_scopes(scopes), m_sleepMs(sleepMs) {}
+
+        std::atomic<int> continued = 0;
+
+        void test() override {
+            for (int i = 0; i < m_scopes; ++i) {
+                it("Fails " + std::to_string(i), [&]() {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(m_sleepMs));
+                    assertTrue(false);
+                    ++continued;
+                    assertTrue(true);
+                });
+            }
+        }
+
+    private:
+        int m_scopes, m_sleepMs;
+    };
+
+    /**
+     * Test case with an assertion which fails inside ``assertException``.
+     */
+    class FailingInsideCase : public TestCase {
+    public:
+        std::atomic<int> continued = 0;
+
+        void test() override {
+            it("Fails inside", [&]() {
+                assertException<std::bad_optional_access>([&]() {
+                    assertTrue(false);
+                    throw std::bad_optional_access();
+                });
+                ++continued;
+                assertTrue(true);
+            });
+        }
+    };
+
+    /**
+     * Test case which allocates, and keeps one of the allocations past its scope.
+     */
+    class AllocatingCase : public TestCase {
+    public:
+        void test() override {
+            it("Keeps a buffer", [&]() {
+                m_kept.assign(10, 1);
+                assertTrue(true);
+            });
+
+            // Sized explicitly, since how a vector grows depends on the standard library
+            it("Allocates temporarily", [&]() {
+                std::vector<int> values(100);
+                std::vector<int> more(200);
+                assertEquals<size_t>(300, values.size() + more.size());
+            });
+        }
+
+    private:
+        std::vector<int> m_kept;
+    };
+
+    /**
+     * Test case with a given name and version, which passes or fails.
+     */
+    class VersionedCase : public TestCase {
+    public:
+        VersionedCase(std::string name, std::string version, bool passes)
+                : m_name(std::move(name)), m_version(std::move(version)), m_passes(passes) {}
+
+        void test() override {
+            it(m_name, [&]() {
+                assertTrue(m_passes);
+            });
+        }
+
+        [[nodiscard]] std::string name() const override {
+            return m_name;
+        }
+
+        [[nodiscard]] std::string version() const override {
+            return m_version;
+        }
+
+    private:
+        std::string m_name, m_version;
+        bool m_passes;
+    };
+
+#ifdef BBUNIT_HAS_PROCESS_POOL
+    /**
+     * Test case which crashes (or hangs) in its second ``it`` scope.
+     */
+    class CrashingCase : public TestCase {
+    public:
+        explicit CrashingCase(bool hang) : m_hang(hang) {}
+
+        void test() override {
+            it("Before the crash", [&]() {
+                assertTrue(true);
+            });
+
+            it("Crashes", [&]() {
+                if (m_hang) {
+                    std::this_thread::sleep_for(std::chrono::seconds(30));
+                } else {
+                    std::raise(SIGSEGV);
+                }
+            });
+        }
+
+    private:
+        bool m_hang;
+    };
+
+    /**
+     * Test case which reports the process it's running in.
+     */
+    class ProcessIdCase : public TestCase {
+    public:
+        void test() override {
+            it(std::to_string(getpid()), [&]() {
+                assertTrue(true);
+            });
+        }
+    };
+#endif
+
+    class RunnerTest : public TestCase {
+    public:
+        /**
+         * Collection of all tests.
+         */
+        void test() override {
+            serialCases();
+            parallelCases();
+            parallelScopes();
+            streaming();
+            timing();
+            isolated();
+            sharding();
+            filtering();
+            failFast();
+            incremental();
+            reporters();
+            summaries();
+            allocationReport();
+        }
+
+        /**
+         * Run test cases one by one, and verify that all results are collected.
+         */
+        void serialCases() {
+            auto subject = std::make_shared<SubjectCase>("Repeated", 3);
+            TestResults res = TestRunner::run({
+                    std::make_shared<SubjectCase>("First", 2),
+                    subject,
+                    std::make_shared<SubjectCase>("Last", 1),
+            });
+            TestResults again = TestRunner::run({subject});
+
+            it("Collects the results of every test case", [&]() {
+                assertCount(6, res);
+                assertEquals<std::string>("First", res[0].description());
+                assertEquals<std::string>("Repeated", res[2].description());
+                assertEquals<std::string>("Last", res[5].description());
+            });
+
+            it("Hands over the results, leaving the test case ready for another run", [&]() {
+                assertCount(3, again);
+            });
+
+            TestResults silenced = whileSilent([&]() -> TestResults {
+                return it("Silenced", [&]() {
+                    assertTrue(true);
+                });
+            });
+
+            TestResults moved = it("Moves the results of a scope into the test case's results", [&]() {
+                assertTrue(true);
+            });
+
+            it("Only returns the results of a scope when silenced", [&]() {
+                assertCount(1, silenced);
+                assertTrue(moved.empty());
+            });
+        }
+
+        /**
+         * Run a number of test cases in parallel, and verify that the
+         * results are merged in the order the cases were provided.
+         */
+        void parallelCases() {
+            std::vector<std::shared_ptr<TestCase>> cases;
+            for (int i = 0; i < 32; ++i) {
+                cases.emplace_back(std::make_shared<SubjectCase>("Case " + std::to_string(i), 1 + i % 4));
+            }
+
+            TestResults res = TestRunner::run(cases, {.parallel = true, .threads = 4});
+
+            it("Runs test cases in parallel and keeps the submission order", [&]() {
+                size_t expectedCount = 0;
+                for (int i = 0; i < 32; ++i) {
+                    expectedCount += 1 + i % 4;
+                }
+                assertCount(expectedCount, res);
+
+                size_t index = 0;
+                bool ordered = true;
+                for (int i = 0; i < 32; ++i) {
+                    for (int j = 0; j < 1 + i % 4; ++j, ++index) {
+                        ordered = ordered && res[index].get().info.description == "Case " + std::to_string(i);
+                    }
+                }
+                assertTrue(ordered);
+            });
+
+            it("Re-throws exceptions from the thread pool, once all tasks are done", [&]() {
+                Utilities::ThreadPool pool(4);
+                std::atomic<int> completed = 0;
+                std::string message;
+                try {
+                    pool.forEach(8, [&](size_t i) {
+                        if (i == 5) {
+                            throw std::runtime_error("Task 5");
+                        }
+                        ++completed;
+                    });
+                } catch (const std::runtime_error &e) {
+                    message = e.what();
+                }
+
+                assertEquals<std::string>("Task 5", message);
+                assertEquals<int>(7, completed.load());
+            });
+        }
+
+        /**
+         * Evaluate ``it`` scopes concurrently, and verify that each scope has
+         * its own assertion state, and that the results keep the declaration order.
+         */
+        void parallelScopes() {
+            TestResults res = whileSilent([&]() -> TestResults {
+                return inParallel([&]() {
+                    for (int i = 0; i < 16; ++i) {
+                        it("Scope " + std::to_string(i), [this, i]() {
+                            // Let the early scopes finish last
+                            std::this_thread::sleep_for(std::chrono::milliseconds(16 - i));
+                            assertEquals<int>(i, i);
+                            assertEquals<int>(i % 3 == 0 ? -1 : i, i);
+                            assertEquals<int>(i, i);
+                        });
+                    }
+                });
+            });
+
+            it("Keeps the declaration order of scopes evaluated in parallel", [&]() {
+                assertCount(48, res);
+
+                bool ordered = true;
+                for (size_t i = 0; i < res.size(); ++i) {
+                    ordered = ordered && res[i].description() == "Scope " + std::to_string(i / 3);
+                }
+                assertTrue(ordered);
+            });
+
+            it("Gives each scope evaluated in parallel its own assertion state", [&]() {
+                for (size_t i = 0; i < 16; ++i) {
+                    assertTrue(res[i * 3].get().passed);
+                    assertEquals<CaseNumber>(1, res[i * 3].get().info.caseNo);
+                    if (i % 3 == 0) {
+                        assertFalse(res[i * 3 + 1].get().passed);
+                        assertTrue(res[i * 3 + 2].isErr());
+                    } else {
+                        assertTrue(res[i * 3 + 1].get().passed);
+                        assertEquals<CaseNumber>(3, res[i * 3 + 2].get().info.caseNo);
+                    }
+                }
+            });
+        }
+
+        /**
+         * Stream results to a sink, instead of collecting them.
+         */
+        void streaming() {
+            auto collector = std::make_shared<ResultCollector>();
+            Settings settings;
+            settings.sink = collector;
+            TestResults returned = TestRunner::run({
+                    std::make_shared<SubjectCase>("First", 2),
+                    std::make_shared<SubjectCase>("Second", 3),
+            }, settings);
+
+            it("Streams results to the sink, rather than returning them", [&]() {
+                assertTrue(returned.empty());
+                assertCount(5, collector->results());
+                assertEquals<std::string>("Second", collector->results()[4].description());
+            });
+
+            auto recorder = std::make_shared<BatchRecordingSink>();
+            settings.sink = recorder;
+            settings.sinkBatchSize = 4;
+            TestRunner::run({std::make_shared<LargeScopeCase>(10)}, settings);
+
+            it("Flushes large scopes to the sink in batches", [&]() {
+                assertCount(3, recorder->batches);
+                assertEquals<size_t>(4, recorder->batches[0]);
+                assertEquals<size_t>(4, recorder->batches[1]);
+                assertEquals<size_t>(2, recorder->batches[2]);
+                assertEquals<CaseNumber>(10, recorder->results()[9].caseNo());
+                assertEquals<std::string>("Large scope", recorder->results()[9].description());
+                assertEquals<int>(1, recorder->finished);
+            });
+
+            auto parallelCollector = std::make_shared<ResultCollector>();
+            settings.sink = parallelCollector;
+            settings.sinkBatchSize = 0;
+            settings.parallel = true;
+            std::vector<std::shared_ptr<TestCase>> cases;
+            for (int i = 0; i < 16; ++i) {
+                cases.emplace_back(std::make_shared<SubjectCase>("Case " + std::to_string(i), 2));
+            }
+            TestRunner::run(cases, settings);
+
+            it("Streams results from test cases running in parallel", [&]() {
+                assertCount(32, parallelCollector->results());
+            });
+        }
+
+        /**
+         * Measure the time spent on test cases, scopes and (optionally) assertions.
+         */
+        void timing() {
+            TestResults res = TestRunner::run({
+                    std::make_shared<SubjectCase>("Timed", 2),
+                    std::make_shared<LargeScopeCase>(3),
+            });
+
+            it("Records the time spent on each scope and test case", [&]() {
+                assertCount(3, res.scopes());
+                assertEquals<std::string>("Timed", res.scopes()[0].description);
+                assertEquals<std::string>("BBUnit::Tests::SubjectCase", res.scopes()[0].testCase);
+                assertEquals<std::string>("BBUnit::Tests::LargeScopeCase", res[4].testCase());
+
+                assertCount(2, res.caseTimings());
+                assertEquals<std::string>("BBUnit::Tests::LargeScopeCase", res.caseTimings()[1].testCase);
+                assertTrue(res.caseTimings()[1].timing.wall >= res.scopes()[2].timing.wall);
+            });
+
+            it("Only times individual assertions when asked to", [&]() {
+                assertEquals<long long>(0, res[0].timing().wall.count());
+            });
+
+            TestResults timed = TestRunner::run({std::make_shared<LargeScopeCase>(3)}, {.timeAssertions = true});
+
+            it("Times individual assertions", [&]() {
+                bool measured = true;
+                for (ResultRef result: timed) {
+                    measured = measured && result.timing().wall.count() > 0;
+                }
+                assertCount(3, timed);
+                assertTrue(measured);
+            });
+        }
+
+        /**
+         * Run test cases in worker processes, where crashes and hangs
+         * are reported as errors.
+         */
+        void isolated() {
+#ifdef BBUNIT_HAS_PROCESS_POOL
+            TestResults res = TestRunner::run({
+                    std::make_shared<SubjectCase>("First", 2),
+                    std::make_shared<CrashingCase>(false),
+                    std::make_shared<CrashingCase>(true),
+                    std::make_shared<SubjectCase>("Last", 1),
+            }, {.threads = 2, .isolated = true, .timeout = std::chrono::milliseconds(300)});
+
+            it("Reports crashed and timed out test cases, and keeps the other results", [&]() {
+                assertCount(7, res);
+                assertEquals<std::string>("First", res[1].description());
+                assertEquals<std::string>("Before the crash", res[2].description());
+
+                assertTrue(res[3].isErr());
+                assertTrue(res[3].errorCode() == ErrorCode::Crashed);
+                assertEquals<std::string>("BBUnit::Tests::CrashingCase", res[3].description());
+                assertTrue(res[3].message().find("signal 11") != std::string::npos);
+
+                assertEquals<std::string>("Before the crash", res[4].description());
+                assertTrue(res[5].errorCode() == ErrorCode::TimedOut);
+                assertEquals<std::string>("Last", res[6].description());
+            });
+
+            it("Hands the scope and test case timings back from the workers", [&]() {
+                assertCount(2, res.caseTimings());
+            });
+
+            auto database = std::make_shared<Utilities::ResultsDatabase>();
+            TestRunner::run({std::make_shared<CrashingCase>(false)}, {.isolated = true, .resultsDatabase = database});
+
+            it("Records the time until the crash, when there's no timeout", [&]() {
+                assertTrue(database->find("BBUnit::Tests::CrashingCase")->failed);
+                assertTrue(database->find("BBUnit::Tests::CrashingCase")->duration.count() > 0);
+            });
+
+            std::vector<std::shared_ptr<TestCase>> cases;
+            for (int i = 0; i < 12; ++i) {
+                cases.emplace_back(std::make_shared<ProcessIdCase>());
+            }
+            TestResults pids = TestRunner::run(cases, {.threads = 3, .isolated = true});
+
+            it("Reuses the worker processes", [&]() {
+                std::set<std::string> distinct;
+                for (ResultRef result: pids) {
+                    distinct.insert(result.description());
+                }
+                assertCount(12, pids);
+                assertTrue(distinct.size() <= 3);
+                assertFalse(distinct.contains(std::to_string(getpid())));
+            });
+#endif
+        }
+
+        /**
+         * Split the test cases into shards, balanced by recorded durations.
+         */
+        void sharding() {
+            using std::chrono::milliseconds;
+
+            std::vector<unsigned int> balanced = Utilities::Sharding::assign({
+                    milliseconds(50), milliseconds(10), std::nullopt, milliseconds(40), milliseconds(20),
+            }, 2);
+
+            it("Balances the shards by expected duration", [&]() {
+                // 50 -> 0, 40 -> 1, 20 (unknown counts as the median) -> 1, 20 -> 0, 10 -> 1
+                std::vector<unsigned int> expected = {0, 1, 1, 1, 0};
+                assertTrue(balanced == expected);
+            });
+
+            it("Balances the shards by count, when no durations are known", [&]() {
+                std::vector<unsigned int> expected = {0, 1, 2, 0, 1};
+                assertTrue(Utilities::Sharding::assign(std::vector<std::optional<std::chrono::nanoseconds>>(5), 3) == expected);
+            });
+
+            std::vector<std::shared_ptr<TestCase>> cases;
+            for (int i = 0; i < 7; ++i) {
+                cases.emplace_back(std::make_shared<SubjectCase>("Case " + std::to_string(i), 1));
+            }
+
+            std::vector<std::string> ran;
+            for (unsigned int index = 0; index < 3; ++index) {
+                for (ResultRef result: TestRunner::run(cases, {.shardIndex = index, .shardCount = 3})) {
+                    ran.push_back(result.description());
+                }
+            }
+
+            it("Runs every test case in exactly one shard", [&]() {
+                std::sort(ran.begin(), ran.end());
+                assertCount(7, ran);
+                assertTrue(std::adjacent_find(ran.begin(), ran.end()) == ran.end());
+            });
+
+            auto durations = std::make_shared<Utilities::CaseDurations>();
+            durations->set("Listed", std::chrono::hours(1));
+            std::vector<std::shared_ptr<TestCase>> partial = {
+                    std::make_shared<VersionedCase>("Listed", "1", true),
+                    std::make_shared<VersionedCase>("Filtered", "1", true),
+            };
+            TestRunner::run(partial, {.listOnly = true, .caseDurations = durations});
+
+            it("Doesn't record durations when listing", [&]() {
+                assertTrue(durations->find("Listed") == std::chrono::hours(1));
+                assertFalse(durations->find("Filtered").has_value());
+            });
+
+            TestRunner::run(partial, {.itFilter = Utilities::NameFilter("Listed"), .caseDurations = durations});
+
+            it("Records durations only when every scope ran", [&]() {
+                assertTrue(durations->find("Listed") < std::chrono::hours(1));
+                assertFalse(durations->find("Filtered").has_value());
+            });
+
+            it("Rejects a shard index which is out of range", [&]() {
+                // Including an index without a count, and a count of zero
+                for (auto [index, count]: {std::pair{3u, 3u}, {3u, 1u}, {1u, 0u}}) {
+                    bool thrown = false;
+                    try {
+                        TestRunner::run(cases, {.shardIndex = index, .shardCount = count});
+                    } catch (const std::invalid_argument &) {
+                        thrown = true;
+                    }
+                    assertTrue(thrown);
+                }
+            });
+
+            Settings settings;
+            const char *argv[] = {"tests", "--shard-index", "2", "--other", "--shard-count=4", "--counters"};
+            Utilities::CommandLine::apply(6, argv, settings);
+
+            it("Reads the shard from the command line", [&]() {
+                assertEquals<unsigned int>(2, settings.shardIndex);
+                assertEquals<unsigned int>(4, settings.shardCount);
+                assertTrue(settings.countHardwareEvents);
+
+                for (const char *option: {"--shard-count=two", "--shard-count=0"}) {
+                    bool thrown = false;
+                    const char *invalid[] = {"tests", option};
+                    try {
+                        Utilities::CommandLine::apply(2, invalid, settings);
+                    } catch (const std::invalid_argument &) {
+                        thrown = true;
+                    }
+                    assertTrue(thrown);
+                }
+            });
+        }
+
+        /**
+         * Select test cases and scopes by name, and list them without running them.
+         */
+        void filtering() {
+            it("Matches names against globs and regular expressions", [&]() {
+                Utilities::NameFilter filter("*two,Be?a,re:^Gam+a");
+                assertTrue(filter.matches("Alpha two"));
+                assertTrue(filter.matches("Beta"));
+                assertTrue(filter.matches("Gamma ray"));
+                assertFalse(filter.matches("Alpha one"));
+                assertFalse(filter.matches("Betamax"));
+                assertTrue(Utilities::NameFilter().matches("Anything"));
+                assertTrue(Utilities::NameFilter::matchGlob("a*b*c", "aXbYbZc"));
+                assertFalse(Utilities::NameFilter::matchGlob("a*b*c", "aXbYbZ"));
+            });
+
+            auto counting = std::make_shared<CountingCase>();
+            TestResults selected = TestRunner::run({
+                    std::make_shared<SubjectCase>("Subject", 1),
+                    counting,
+            }, {.caseFilter = Utilities::NameFilter("*Counting*"), .itFilter = Utilities::NameFilter("Alpha*")});
+
+            it("Only runs the selected test cases and scopes", [&]() {
+                assertCount(2, selected);
+                assertEquals<std::string>("Alpha two", selected[1].description());
+                assertEquals<int>(2, counting->evaluated);
+            });
+
+            auto listed = std::make_shared<CountingCase>();
+            TestResults list = TestRunner::run({listed}, {.listOnly = true});
+
+            it("Lists the scopes without evaluating them", [&]() {
+                assertTrue(list.empty());
+                assertCount(3, list.scopes());
+                assertEquals<std::string>("Beta", list.scopes()[2].description);
+                assertEquals<std::string>("BBUnit::Tests::CountingCase", list.scopes()[2].testCase);
+                assertEquals<int>(0, listed->evaluated);
+            });
+
+            TestResults inspected = TestRunner::run({std::make_shared<InspectingCase>()},
+                                                    {.itFilter = Utilities::NameFilter("Inspects*")});
+            TestResults excluded = TestRunner::run({std::make_shared<InspectingCase>()},
+                                                   {.itFilter = Utilities::NameFilter("re:^Subject$")});
+
+            it("Always evaluates silenced scopes, which the test inspects", [&]() {
+                assertCount(2, inspected);
+                assertEquals<std::string>("Inspects the subject", inspected[1].description());
+                assertTrue(inspected[1].passed());
+                assertTrue(excluded.empty());
+            });
+
+            it("Refuses results beyond the end", [&]() {
+                bool thrown = false;
+                try {
+                    (void) excluded[0];
+                } catch (const std::out_of_range &) {
+                    thrown = true;
+                }
+                assertTrue(thrown);
+            });
+        }
+
+        /**
+         * Cut scopes and runs short, once assertions fail.
+         */
+        void failFast() {
+            auto skipping = std::make_shared<FailingCase>(2);
+            TestResults skipped = TestRunner::run({skipping}, {.skipScopeAfterFail = true});
+
+            it("Skips the rest of a scope after a failed assertion", [&]() {
+                assertCount(2, skipped);
+                assertFalse(skipped[0].passed());
+                assertFalse(skipped[1].isErr());
+                assertEquals<int>(0, skipping->continued.load());
+            });
+
+            auto inside = std::make_shared<FailingInsideCase>();
+            TestResults skippedInside = TestRunner::run({inside}, {.skipScopeAfterFail = true});
+
+            it("Skips the rest of a scope after a failed assertion inside assertException", [&]() {
+                assertCount(1, skippedInside);
+                assertFalse(skippedInside[0].passed());
+                assertFalse(skippedInside[0].isErr());
+                assertEquals<int>(0, inside->continued.load());
+            });
+
+            std::vector<std::shared_ptr<TestCase>> cases;
+            for (int i = 0; i < 5; ++i) {
+                cases.emplace_back(std::make_shared<FailingCase>(2));
+            }
+            TestResults limited = TestRunner::run(cases, {.maxFailures = 3});
+
+            it("Stops the run after the max. number of failures", [&]() {
+                assertEquals<size_t>(3, limited.failures());
+                assertCount(3, limited.scopes());
+                assertEquals<std::string>("Fails 0", limited.scopes()[2].description);
+            });
+
+            cases.clear();
+            for (int i = 0; i < 32; ++i) {
+                cases.emplace_back(std::make_shared<FailingCase>(1, 5));
+            }
+            auto budget = std::make_shared<Utilities::FailureBudget>(1);
+            TestResults parallel = TestRunner::run(cases, {.parallel = true, .threads = 4, .failureBudget = budget});
+
+            it("Cancels test cases running in parallel", [&]() {
+                assertTrue(budget->exhausted());
+                assertTrue(parallel.failures() < 32);
+            });
+        }
+
+        /**
+         * Only run the test cases which failed or changed since the previous run.
+         */
+        void incremental() {
+            auto database = std::make_shared<Utilities::ResultsDatabase>();
+            TestRunner::run({
+                    std::make_shared<VersionedCase>("A", "1", true),
+                    std::make_shared<VersionedCase>("B", "1", false),
+                    std::make_shared<VersionedCase>("C", "1", true),
+            }, {.resultsDatabase = database});
+
+            it("Records the outcome of each test case", [&]() {
+                assertTrue(database->find("A").has_value());
+                assertFalse(database->find("A")->failed);
+                assertTrue(database->find("B")->failed);
+                assertEquals<std::string>("1", database->find("C")->version);
+            });
+
+            std::vector<std::shared_ptr<TestCase>> cases = {
+                    std::make_shared<VersionedCase>("A", "1", true),
+                    std::make_shared<VersionedCase>("B", "1", true),
+                    std::make_shared<VersionedCase>("C", "2", true),
+                    std::make_shared<VersionedCase>("D", "1", true),
+            };
+            TestRunner::run(cases, {.listOnly = true, .resultsDatabase = database});
+            TestRunner::run(cases, {.itFilter = Utilities::NameFilter("A"), .resultsDatabase = database});
+
+            it("Keeps the failures when listing, or running some of the scopes", [&]() {
+                assertTrue(database->find("B")->failed);
+                assertFalse(database->find("D").has_value());
+            });
+
+            TestResults failed = TestRunner::run(cases, {.resultsDatabase = database, .rerunFailed = true});
+
+            it("Reruns the test cases which failed", [&]() {
+                assertCount(1, failed);
+                assertEquals<std::string>("B", failed[0].description());
+                assertFalse(database->find("B")->failed);
+            });
+
+            TestResults changed = TestRunner::run(cases, {.resultsDatabase = database, .changedOnly = true});
+
+            it("Runs the test cases which are new or changed", [&]() {
+                assertCount(2, changed);
+                assertEquals<std::string>("C", changed[0].description());
+                assertEquals<std::string>("D", changed[1].description());
+            });
+
+            std::filesystem::path path = std::filesystem::temp_directory_path() / "bbunit-malformed-test.txt";
+            std::ofstream(path) << "1\tx\t1\tBad\n0\t12\nnot a line\n250\t0\t1\tTwo\n2.5\tThree\nabc\tWord\n0\t250\t1\tGood\n";
+            Utilities::ResultsDatabase loadedDatabase(path.string());
+            Utilities::CaseDurations loadedDurations(path.string());
+            BenchmarkBaseline loadedBaseline(path.string());
+            std::filesystem::remove(path);
+
+            it("Skips malformed lines in the files it reads", [&]() {
+                assertFalse(loadedDatabase.find("Bad").has_value());
+                assertFalse(loadedDatabase.find("Two").has_value());
+                assertEquals<long long>(250, loadedDatabase.find("Good")->duration.count());
+                assertFalse(loadedDurations.find("Three").has_value());
+                assertEquals<long long>(0, loadedDurations.find("12")->count());
+                assertEquals<double>(2.5, loadedBaseline.find("Three")->count());
+                assertFalse(loadedDurations.find("Word").has_value());
+                assertFalse(loadedBaseline.find("Word").has_value());
+            });
+        }
+
+        /**
+         * Write machine-readable reports while the tests run.
+         */
+        void reporters() {
+            auto read = [](const std::filesystem::path &path) {
+                std::ifstream file(path);
+                return std::string(std::istreambuf_iterator<char>(file), {});
+            };
+
+            std::filesystem::path directory = std::filesystem::temp_directory_path();
+            std::filesystem::path xmlPath = directory / "bbunit-junit-test.xml";
+            std::filesystem::path jsonPath = directory / "bbunit-json-test.jsonl";
+            std::filesystem::path printPath = directory / "bbunit-printer-test.txt";
+
+            auto collector = std::make_shared<ResultCollector>();
+            {
+                Utilities::OutputBuffer printed(printPath.string());
+                Settings settings;
+                settings.sink = std::make_shared<TeeSink>(std::vector<std::shared_ptr<ResultSink>>{
+                        std::make_shared<Utilities::JUnitReporter>(xmlPath.string()),
+                        std::make_shared<Utilities::JsonLinesReporter>(jsonPath.string()),
+                        std::make_shared<Utilities::Printer>(printed.fd(), Utilities::PrinterSettings{.printPassed = true}),
+                        collector,
+                });
+                TestRunner::run({
+                        std::make_shared<SubjectCase>("Passes <&>", 1),
+                        std::make_shared<FailingCase>(1),
+                }, settings);
+            }
+
+            std::string xml = read(xmlPath), json = read(jsonPath), text = read(printPath);
+            std::filesystem::remove(xmlPath);
+            std::filesystem::remove(jsonPath);
+            std::filesystem::remove(printPath);
+
+            it("Hands every batch to all the sinks of a tee", [&]() {
+                assertCount(3, collector->results());
+            });
+
+            it("Writes a JUnit XML report, with the totals filled in", [&]() {
+                assertTrue(xml.find(R"(<testsuite name="BBUnit" tests="2" failures="1" errors="0")") != std::string::npos);
+                assertTrue(xml.find(R"(name="Passes &lt;&amp;&gt;")") != std::string::npos);
+                assertTrue(xml.find(R"(<failure type="assertion" message="#1: Expected: true, Actual: false"/>)") != std::string::npos);
+                assertTrue(xml.ends_with("</testsuites>\n"));
+            });
+
+            it("Writes a JSON line for failed assertions, scopes, test cases and the summary", [&]() {
+                assertEquals<long>(7, std::count(json.begin(), json.end(), '\n'));
+                assertTrue(json.find(R"({"type":"assertion","testCase":"BBUnit::Tests::FailingCase","description":"Fails 0","caseNo":1,"status":"failed","expected":"true","actual":"false"})") != std::string::npos);
+                assertTrue(json.find(R"("description":"Passes <&>")") != std::string::npos);
+                assertTrue(json.find(R"({"type":"summary","passed":1,"failed":1,"errors":1})") != std::string::npos);
+            });
+
+            it("Prints the results and the summary to a file descriptor", [&]() {
+                assertTrue(text.starts_with("C++ BBUnit\n PASS  Passes <&> #1\n"));
+                assertTrue(text.find(" FAIL  Fails 0 #1\n       Expected: true, Actual: false\n") != std::string::npos);
+                assertTrue(text.ends_with(" FAIL  Total: 3       | Passed: 1      | Failed: 1      | Errors: 1     "));
+            });
+
+            std::filesystem::path batchedPath = directory / "bbunit-junit-batched-test.xml";
+            {
+                Settings settings;
+                settings.sink = std::make_shared<Utilities::JUnitReporter>(batchedPath.string());
+                settings.sinkBatchSize = 3;
+                TestRunner::run({std::make_shared<LargeScopeCase>(10, 1)}, settings);
+            }
+            std::string batched = read(batchedPath);
+            std::filesystem::remove(batchedPath);
+
+            it("Writes a scope handed over in several batches as one timed test case", [&]() {
+                assertTrue(batched.find(R"(<testsuite name="BBUnit" tests="1" failures="1" errors="0")") != std::string::npos);
+                size_t element = batched.find(R"(name="Large scope")");
+                assertTrue(element != std::string::npos);
+                assertTrue(batched.find(R"(name="Large scope")", element + 1) == std::string::npos);
+                assertTrue(batched.compare(batched.find("time=", element), 16, R"(time="0.000000")") != 0);
+                assertTrue(batched.find(R"(<failure type="assertion" message="#2: Expected: 1, Actual: -1"/>)") != std::string::npos);
+            });
+
+            std::filesystem::path instantXmlPath = directory / "bbunit-junit-instant-test.xml";
+            std::filesystem::path instantJsonPath = directory / "bbunit-json-instant-test.jsonl";
+            {
+                Utilities::JUnitReporter junit(instantXmlPath.string());
+                Utilities::JsonLinesReporter jsonLines(instantJsonPath.string());
+                for (ResultSink *sink: std::initializer_list<ResultSink *>{&junit, &jsonLines}) {
+                    for (const char *description: {"Instant", "Next"}) {
+                        // Finished without taking any measurable time, like the error of a crashed test case
+                        TestResults instant;
+                        instant.beginScope(description, "Case");
+                        instant.addError(0, ErrorCode::Crashed, "Signal");
+                        instant.finishScope("Case", {});
+                        sink->push(std::move(instant));
+                    }
+                    sink->finish();
+                }
+            }
+            std::string instantXml = read(instantXmlPath), instantJson = read(instantJsonPath);
+            std::filesystem::remove(instantXmlPath);
+            std::filesystem::remove(instantJsonPath);
+
+            it("Writes finished scopes, even when they took no measurable time", [&]() {
+                assertTrue(instantXml.find(R"(<testsuite name="BBUnit" tests="2" failures="0" errors="2")") != std::string::npos);
+                assertTrue(instantJson.find(R"({"type":"scope","testCase":"Case","description":"Instant")") != std::string::npos);
+            });
+
+#ifndef _WIN32
+            std::filesystem::path appendedPath = directory / "bbunit-junit-appended-test.xml";
+            std::ofstream(appendedPath) << "Earlier\n";
+            int appendedFd = open(appendedPath.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+            {
+                Settings settings;
+                settings.sink = std::make_shared<Utilities::JUnitReporter>(appendedFd);
+                TestRunner::run({std::make_shared<SubjectCase>("Appended", 1)}, settings);
+            }
+            close(appendedFd);
+            std::string appended = read(appendedPath);
+            std::filesystem::remove(appendedPath);
+
+            it("Leaves the totals out, when appending to a file", [&]() {
+                assertTrue(appended.starts_with("Earlier\n<?xml"));
+                assertTrue(appended.find("tests=") == std::string::npos);
+                assertTrue(appended.ends_with("</testsuites>\n"));
+            });
+#endif
+
+            it("Escapes JSON strings", [&]() {
+                std::filesystem::path path = directory / "bbunit-escape-test.json";
+                {
+                    Utilities::OutputBuffer out(path.string());
+                    Utilities::JsonLinesReporter::appendString(out, "a\"b\\c\nd\x01");
+                }
+                assertEquals<std::string>(R"("a\"b\\c\nd\u0001")", read(path));
+                std::filesystem::remove(path);
+            });
+        }
+
+        /**
+         * Print the allocations of the scopes, which the self-test tracks.
+         */
+        void allocationReport() {
+            std::filesystem::path path = std::filesystem::temp_directory_path() / "bbunit-allocations-test.txt";
+            {
+                Utilities::OutputBuffer printed(path.string());
+                Settings settings;
+                settings.sink = std::make_shared<Utilities::Printer>(printed.fd(), Utilities::PrinterSettings{.allocations = 5});
+                TestRunner::run({std::make_shared<AllocatingCase>()}, settings);
+            }
+
+            std::ifstream file(path);
+            std::string text(std::istreambuf_iterator<char>(file), {});
+            file.close();
+            std::filesystem::remove(path);
+
+            it("Lists the scopes which allocated the most, and which leaked", [&]() {
+                assertTrue(text.find(" Most allocations\n"
+                                     "       Allocs    Bytes       Peak        Leaked    Test\n"
+                                     "       2         1200        1200        0         BBUnit::Tests::AllocatingCase: Allocates temporarily\n"
+                                     "       1         40          40          1         BBUnit::Tests::AllocatingCase: Keeps a buffer\n") != std::string::npos);
+                assertTrue(text.find(" Leaks\n"
+                                     "       Allocs    Bytes       Peak        Leaked    Test\n"
+                                     "       1         40          40          1         BBUnit::Tests::AllocatingCase: Keeps a buffer\n") != std::string::npos);
+            });
+
+            it("Shows the allocations in the summary", [&]() {
+                assertTrue(text.ends_with("\n       Allocations: 3       | Bytes: 1240          | Leaked: 1     "));
+            });
+        }
+
+        /**
+         * Count results per test case and scope while they're streamed, beyond the range of 16-bit counters.
+         */
+        void summaries() {
+            auto collector = std::make_shared<ResultCollector>();
+            auto summarySink = std::make_shared<Utilities::SummarySink>();
+            Settings settings;
+            settings.sink = std::make_shared<TeeSink>(std::vector<std::shared_ptr<ResultSink>>{collector, summarySink});
+            settings.sinkBatchSize = 1000;
+            TestRunner::run({
+                    std::make_shared<LargeScopeCase>(70000),
+                    std::make_shared<SubjectCase>("Twice", 2),
+                    std::make_shared<FailingCase>(2),
+            }, settings);
+
+            const Utilities::ResultSummary &summary = summarySink->summary();
+
+            it("Numbers assertions past 65535", [&]() {
+                assertEquals<CaseNumber>(70000, collector->results()[69999].caseNo());
+            });
+
+            it("Counts the totals", [&]() {
+                assertEquals<uint64_t>(70002, summary.totals().passed);
+                assertEquals<uint64_t>(2, summary.totals().failed);
+                assertEquals<uint64_t>(2, summary.totals().errors);
+                assertFalse(summary.totals().ok());
+            });
+
+            it("Counts per test case", [&]() {
+                assertEquals<size_t>(3, summary.cases().size());
+                assertEquals<uint64_t>(2, summary.find("BBUnit::Tests::SubjectCase")->passed);
+                assertEquals<uint64_t>(4, summary.find("BBUnit::Tests::FailingCase")->total());
+                assertTrue(summary.find("Unknown") == nullptr);
+            });
+
+            it("Counts a scope handed over in several batches once", [&]() {
+                const Utilities::ResultCounts *counts = summary.find("BBUnit::Tests::LargeScopeCase", "Large scope");
+                assertTrue(counts != nullptr);
+                assertEquals<uint64_t>(70000, counts->passed);
+                assertEquals<size_t>(4, summary.scopes().size());
+            });
+        }
+    };
+}